@@ -0,0 +1,108 @@
+/**
+ * @file ansicolor.cpp
+ * @brief Implementation of the AnsiColor class.
+ */
+
+#include "ansicolor.hpp"
+#include <algorithm>
+
+namespace
+{
+    // codes of palette colors carry this bit, truecolor codes are 0xRRGGBB
+    const uint32_t PALETTE = 0x1000000;
+
+    // the component values of the 6x6x6 color cube of the 256-color palette
+    const int CUBE[6] = {0, 95, 135, 175, 215, 255};
+
+    int cubeIndex(int value)
+    {
+        return value < 48 ? 0 : value < 115 ? 1 : std::min(5, (value - 35) / 40);
+    }
+
+    int distance(int red, int green, int blue, int r, int g, int b)
+    {
+        return (red - r) * (red - r) + (green - g) * (green - g) + (blue - b) * (blue - b);
+    }
+
+    void appendNumber(unsigned number, std::string &frame)
+    {
+        char digits[4];
+        int count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + number % 10);
+            number /= 10;
+        } while (number);
+        while (count)
+        {
+            frame.push_back(digits[--count]);
+        }
+    }
+}
+
+uint32_t AnsiColor::quantize(Mode mode, unsigned char red, unsigned char green, unsigned char blue)
+{
+    if (mode == MODE_TRUECOLOR)
+    {
+        auto round = [](int value) { return static_cast<uint32_t>(std::min(255, (value + TRUECOLOR_STEP / 2) / TRUECOLOR_STEP * TRUECOLOR_STEP)); };
+        return round(red) << 16 | round(green) << 8 | round(blue);
+    }
+
+    // the nearest of the cube color and the grey ramp entry (232 to 255, 8 to 238 in steps of 10)
+    const int r = cubeIndex(red), g = cubeIndex(green), b = cubeIndex(blue);
+    const int grey = std::min(23, std::max(0, ((red + green + blue) / 3 - 3) / 10));
+    const int level = 8 + 10 * grey;
+    if (distance(red, green, blue, level, level, level) < distance(red, green, blue, CUBE[r], CUBE[g], CUBE[b]))
+        return PALETTE | (232 + grey);
+    return PALETTE | (16 + 36 * r + 6 * g + b);
+}
+
+void AnsiColor::appendColor(uint32_t code, std::string &frame)
+{
+    if (code == DEFAULT)
+    {
+        frame.append("\033[39m");
+    }
+    else if (code & PALETTE)
+    {
+        frame.append("\033[38;5;");
+        appendNumber(code & 0xFF, frame);
+        frame.push_back('m');
+    }
+    else
+    {
+        frame.append("\033[38;2;");
+        appendNumber(code >> 16, frame);
+        frame.push_back(';');
+        appendNumber(code >> 8 & 0xFF, frame);
+        frame.push_back(';');
+        appendNumber(code & 0xFF, frame);
+        frame.push_back('m');
+    }
+}
+
+void AnsiColor::appendRow(const char *cells, const uint32_t *colors, int count, const CellEncoding &encoding, uint32_t &current, std::string &frame)
+{
+    if (!colors)
+    {
+        encoding.appendRow(cells, count, frame);
+        return;
+    }
+
+    for (int x = 0; x < count; ++x)
+    {
+        if (!encoding.isBlank(cells[x]) && colors[x] != current)
+        {
+            current = colors[x];
+            appendColor(current, frame);
+        }
+        encoding.append(cells[x], frame);
+    }
+}
+
+void AnsiColor::appendDefault(uint32_t &current, std::string &frame)
+{
+    if (current != DEFAULT)
+        appendColor(DEFAULT, frame);
+    current = DEFAULT;
+}
@@ -0,0 +1,76 @@
+#ifndef ANSICOLOR_H
+#define ANSICOLOR_H
+
+#include "cellencoding.hpp"
+#include <cstdint>
+#include <string>
+
+/**
+ * @class AnsiColor
+ * @brief Foreground colors of terminal cells as SGR escape sequences.
+ *
+ * A color is quantized to a code once per cell: in truecolor mode every component is rounded to
+ * a multiple of TRUECOLOR_STEP, in 256-color mode the nearest entry of the xterm color cube or
+ * grey ramp is taken. Cells with the same code then form a run which is preceded by a single
+ * escape sequence, and changes smaller than the quantization never cost any output.
+ */
+class AnsiColor
+{
+public:
+    /**
+     * @enum Mode
+     * @brief The kind of color sequences the terminal understands.
+     */
+    enum Mode
+    {
+        MODE_NONE,      /**< No colors, only glyphs. */
+        MODE_256,       /**< 256-color palette, ESC[38;5;<index>m. */
+        MODE_TRUECOLOR  /**< 24-bit colors, ESC[38;2;<r>;<g>;<b>m. */
+    };
+
+    /** The code of the default foreground color. */
+    static constexpr uint32_t DEFAULT = 0xFFFFFFFF;
+
+    /** The quantization step of the components in truecolor mode. */
+    static constexpr int TRUECOLOR_STEP = 8;
+
+    /**
+     * @brief Quantize a color.
+     * @param mode The color mode, not MODE_NONE.
+     * @param red The red component.
+     * @param green The green component.
+     * @param blue The blue component.
+     * @return The code of the color, equal for colors which are shown the same.
+     */
+    static uint32_t quantize(Mode mode, unsigned char red, unsigned char green, unsigned char blue);
+
+    /**
+     * @brief Append the escape sequence of a color.
+     * @param code The code of the color.
+     * @param frame The string to append to.
+     */
+    static void appendColor(uint32_t code, std::string &frame);
+
+    /**
+     * @brief Append cells with their colors.
+     * @param cells The cells.
+     * @param colors The code of every cell, nullptr for no colors.
+     * @param count The number of cells.
+     * @param encoding The encoding of the cells.
+     * @param current The color in effect, updated to the color in effect after the cells.
+     * @param frame The string to append to.
+     *
+     * A sequence is only written before a cell whose color differs from the one in effect,
+     * blank cells show no color and never change it.
+     */
+    static void appendRow(const char *cells, const uint32_t *colors, int count, const CellEncoding &encoding, uint32_t &current, std::string &frame);
+
+    /**
+     * @brief Append the sequence back to the default color if another one is in effect.
+     * @param current The color in effect, DEFAULT afterwards.
+     * @param frame The string to append to.
+     */
+    static void appendDefault(uint32_t &current, std::string &frame);
+};
+
+#endif
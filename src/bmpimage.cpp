@@ -1,10 +1,356 @@
 #include "bmpimage.hpp"
-#include <cstdio>
+#include "filemapping.hpp"
+#include "luminance.hpp"
+#include <cstdint>
 #include <cstdlib>
-#include <fstream>
+#include <cstring>
 #include <iostream>
 #include <algorithm>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BMP_X86 1
+#endif
+
+namespace
+{
+    const uint32_t COMPRESSION_RGB = 0;
+    const uint32_t COMPRESSION_RLE8 = 1;
+    const uint32_t COMPRESSION_BITFIELDS = 3;
+    const uint32_t COMPRESSION_ALPHABITFIELDS = 6;
+
+    const size_t FILE_HEADER_SIZE = 14;
+    const size_t CORE_HEADER_SIZE = 12;
+    const size_t INFO_HEADER_SIZE = 40;
+
+    uint16_t readU16(const unsigned char *p)
+    {
+        return static_cast<uint16_t>(p[0] | p[1] << 8);
+    }
+
+    uint32_t readU32(const unsigned char *p)
+    {
+        return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    int32_t readI32(const unsigned char *p)
+    {
+        return static_cast<int32_t>(readU32(p));
+    }
+
+    /**
+     * @brief Copy a row of 3 or 4 byte pixels to RGB.
+     * @param source The stored pixels.
+     * @param bytesPerPixel 3 or 4.
+     * @param offset The byte offsets of red, green and blue in a stored pixel.
+     * @param rgb The output, 3 bytes per pixel.
+     * @param count The number of pixels.
+     */
+    void swizzleRowScalar(const unsigned char *source, int bytesPerPixel, const int *offset, unsigned char *rgb, int count)
+    {
+        for (int x = 0; x < count; ++x, source += bytesPerPixel, rgb += 3)
+        {
+            rgb[0] = source[offset[0]];
+            rgb[1] = source[offset[1]];
+            rgb[2] = source[offset[2]];
+        }
+    }
+
+#ifdef BMP_X86
+    /**
+     * @brief SSSE3 version of swizzleRowScalar, one byte shuffle per 16 bytes.
+     *
+     * 3 byte pixels are done 5 per step, 4 byte pixels 4 per step. The 16 byte loads and stores
+     * reach into the following pixels, so the vector loop stops while 6 pixels remain.
+     */
+    __attribute__((target("ssse3"))) void swizzleRowSsse3(const unsigned char *source, int bytesPerPixel, const int *offset, unsigned char *rgb, int count)
+    {
+        const int step = bytesPerPixel == 3 ? 5 : 4;
+        alignas(16) unsigned char order[16];
+        memset(order, 0x80, sizeof(order));
+        for (int k = 0; k < step; ++k)
+            for (int c = 0; c < 3; ++c)
+                order[3 * k + c] = static_cast<unsigned char>(bytesPerPixel * k + offset[c]);
+        const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i *>(order));
+
+        int x = 0;
+        for (; x + 6 <= count; x += step)
+        {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + bytesPerPixel * x));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(rgb + 3 * x), _mm_shuffle_epi8(pixels, mask));
+        }
+        swizzleRowScalar(source + bytesPerPixel * x, bytesPerPixel, offset, rgb + 3 * x, count - x);
+    }
+#endif
+
+    typedef void (*SwizzleKernel)(const unsigned char *, int, const int *, unsigned char *, int);
+
+    SwizzleKernel swizzleKernel()
+    {
+#ifdef BMP_X86
+        static const SwizzleKernel selected = (__builtin_cpu_init(), __builtin_cpu_supports("ssse3") ? swizzleRowSsse3 : swizzleRowScalar);
+        return selected;
+#else
+        return swizzleRowScalar;
+#endif
+    }
+
+    /**
+     * @brief Get the byte offset of an 8 bit channel mask.
+     * @param mask The bit mask of the channel.
+     * @return The offset of the byte, -1 if the mask is not a whole byte.
+     */
+    int maskOffset(uint32_t mask)
+    {
+        for (int offset = 0; offset < 4; ++offset)
+        {
+            if (mask == 0xFFu << (8 * offset))
+                return offset;
+        }
+        return -1;
+    }
+}
+
+bool BmpImage::parseHeader(const unsigned char *data, size_t size, Header &header)
+{
+    if (size < FILE_HEADER_SIZE + CORE_HEADER_SIZE || data[0] != 'B' || data[1] != 'M')
+        return false;
+
+    header.pixelOffset = readU32(data + 10);
+    header.infoSize = readU32(data + 14);
+
+    int32_t height;
+    size_t paletteEntrySize;
+    uint32_t colorsUsed = 0;
+    if (header.infoSize == CORE_HEADER_SIZE)
+    {
+        header.width = readU16(data + 18);
+        height = readU16(data + 20);
+        header.bitsPerPixel = readU16(data + 24);
+        header.compression = COMPRESSION_RGB;
+        paletteEntrySize = 3;
+    }
+    else if (header.infoSize >= INFO_HEADER_SIZE && size >= FILE_HEADER_SIZE + INFO_HEADER_SIZE)
+    {
+        header.width = readI32(data + 18);
+        height = readI32(data + 22);
+        header.bitsPerPixel = readU16(data + 28);
+        header.compression = readU32(data + 30);
+        colorsUsed = readU32(data + 46);
+        paletteEntrySize = 4;
+    }
+    else
+    {
+        return false;
+    }
+
+    header.topDown = height < 0;
+    header.height = height < 0 ? -static_cast<int64_t>(height) : height;
+
+    // keep width * height * 3 far from overflowing
+    const int maxSide = 1 << 16;
+    if (header.width <= 0 || header.height <= 0 || header.width > maxSide || header.height > maxSide)
+        return false;
+    if (header.pixelOffset >= size)
+        return false;
+
+    switch (header.compression)
+    {
+    case COMPRESSION_RGB:
+        if (header.bitsPerPixel != 1 && header.bitsPerPixel != 4 && header.bitsPerPixel != 8 && header.bitsPerPixel != 24 && header.bitsPerPixel != 32)
+            return false;
+        break;
+    case COMPRESSION_RLE8:
+        // RLE images are always stored bottom-up
+        if (header.bitsPerPixel != 8 || header.topDown)
+            return false;
+        break;
+    case COMPRESSION_BITFIELDS:
+    case COMPRESSION_ALPHABITFIELDS:
+    {
+        // the masks follow the 40 byte info header, V4 and V5 headers contain them at the same place
+        const size_t masks = FILE_HEADER_SIZE + INFO_HEADER_SIZE;
+        if (header.bitsPerPixel != 32 || size < masks + 12)
+            return false;
+        for (int c = 0; c < 3; ++c)
+        {
+            header.channelOffset[c] = maskOffset(readU32(data + masks + 4 * c));
+            if (header.channelOffset[c] < 0)
+                return false;
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+
+    if (header.bitsPerPixel <= 8)
+    {
+        size_t count = colorsUsed ? std::min<uint32_t>(colorsUsed, 256) : 1u << header.bitsPerPixel;
+        const unsigned char *entry = data + FILE_HEADER_SIZE + header.infoSize;
+        if (FILE_HEADER_SIZE + header.infoSize + count * paletteEntrySize > size)
+            return false;
+
+        // indices past the stored colors are black
+        header.palette.assign(256, Pixel{0, 0, 0});
+        for (size_t i = 0; i < count; ++i, entry += paletteEntrySize)
+        {
+            header.palette[i] = Pixel{entry[2], entry[1], entry[0]};
+        }
+    }
+
+    return true;
+}
+
+void BmpImage::decodeTrueColor(const unsigned char *pixels, size_t stride, const Header &header)
+{
+    SwizzleKernel swizzle = swizzleKernel();
+    int bytesPerPixel = header.bitsPerPixel / 8;
+
+    beginRows(header.width, header.height);
+    for (int stored = 0; stored < header.height; ++stored, pixels += stride)
+    {
+        int y = header.topDown ? stored : header.height - 1 - stored;
+        swizzle(pixels, bytesPerPixel, header.channelOffset, reinterpret_cast<unsigned char *>(decodeRow(y)), header.width);
+        finishRows(y, 1);
+    }
+    endRows();
+}
+
+void BmpImage::beginIndexedRows(const Header &header, unsigned char *greyOfIndex)
+{
+    if (m_streaming)
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            greyOfIndex[i] = Luminance::greyOf(header.palette[i].red, header.palette[i].green, header.palette[i].blue);
+        }
+        beginGreyRows(header.width, header.height);
+    }
+    else
+    {
+        beginRows(header.width, header.height);
+    }
+}
+
+void BmpImage::storeIndexedRow(int y, const unsigned char *indices, const Header &header, const unsigned char *greyOfIndex)
+{
+    if (m_streaming)
+    {
+        unsigned char *grey = m_grey_image.row(y);
+        for (int x = 0; x < header.width; ++x)
+        {
+            grey[x] = greyOfIndex[indices[x]];
+        }
+        finishGreyRows(y, 1);
+    }
+    else
+    {
+        Pixel *row = decodeRow(y);
+        for (int x = 0; x < header.width; ++x)
+        {
+            row[x] = header.palette[indices[x]];
+        }
+    }
+}
+
+void BmpImage::endIndexedRows()
+{
+    if (m_streaming)
+        endGreyRows();
+    else
+        endRows();
+}
+
+void BmpImage::decodeIndexed(const unsigned char *pixels, size_t stride, const Header &header)
+{
+    unsigned char greyOfIndex[256];
+    std::vector<unsigned char> indices(header.width);
+    const int bits = header.bitsPerPixel;
+    const int perByte = 8 / bits;
+    const unsigned mask = (1u << bits) - 1;
+
+    beginIndexedRows(header, greyOfIndex);
+    for (int stored = 0; stored < header.height; ++stored, pixels += stride)
+    {
+        int y = header.topDown ? stored : header.height - 1 - stored;
+        const unsigned char *row = pixels;
+        if (bits != 8)
+        {
+            // the leftmost pixel is in the most significant bits
+            for (int x = 0; x < header.width; ++x)
+            {
+                int shift = 8 - bits * (x % perByte + 1);
+                indices[x] = (pixels[x / perByte] >> shift) & mask;
+            }
+            row = indices.data();
+        }
+        storeIndexedRow(y, row, header, greyOfIndex);
+    }
+    endIndexedRows();
+}
+
+bool BmpImage::decodeRle8(const unsigned char *pixels, size_t size, const Header &header)
+{
+    // pixels skipped by end of line and delta codes keep index 0
+    Buffer2D<unsigned char> indices(header.width, header.height);
+
+    int x = 0, stored = 0;
+    size_t p = 0;
+    while (p + 2 <= size && stored < header.height)
+    {
+        unsigned count = pixels[p], value = pixels[p + 1];
+        p += 2;
+        unsigned char *row = indices.row(header.height - 1 - stored);
+
+        if (count)
+        {
+            // encoded run: count copies of the index
+            for (unsigned i = 0; i < count && x < header.width; ++i)
+                row[x++] = static_cast<unsigned char>(value);
+        }
+        else if (value == 0)
+        {
+            // end of line
+            x = 0;
+            ++stored;
+        }
+        else if (value == 1)
+        {
+            // end of bitmap
+            break;
+        }
+        else if (value == 2)
+        {
+            // delta: move right and up
+            if (p + 2 > size)
+                return false;
+            x += pixels[p];
+            stored += pixels[p + 1];
+            p += 2;
+        }
+        else
+        {
+            // absolute run of value indices, padded to an even number of bytes
+            if (p + value > size)
+                return false;
+            for (unsigned i = 0; i < value && x < header.width; ++i)
+                row[x++] = pixels[p + i];
+            p += value + (value & 1);
+        }
+    }
+
+    unsigned char greyOfIndex[256];
+    beginIndexedRows(header, greyOfIndex);
+    for (int y = 0; y < header.height; ++y)
+    {
+        storeIndexedRow(y, indices.row(y), header, greyOfIndex);
+    }
+    endIndexedRows();
+
+    return true;
+}
+
 bool BmpImage::loadImage(const std::string &filename)
 {
     /**
@@ -13,50 +359,54 @@ bool BmpImage::loadImage(const std::string &filename)
      * @return True if the image is loaded successfully, false otherwise.
      *
      * This function loads the BMP image data from the specified file.
-     * It reads the BMP header information and pixel data, and stores them in the `m_raw_image` member variable.
+     * The file is memory-mapped and the rows are converted straight out of the mapping.
+     * The pixel array starts at the offset given in the file header, rows are padded to 4 bytes
+     * and stored bottom-up or top-down (negative height).
      * The function returns true if the image is loaded successfully, and false otherwise.
      * If the file does not exist or if the image format is not supported, an error message is displayed.
      */
 
-    std::ifstream file(filename, std::ios::binary);
-
-    if (!file)
+    // The whole file as one byte span, memory-mapped if possible
+    FileMapping file;
+    if (!file.open(filename))
     {
-        std::cout << "There is no such image" << std::endl;
+        reportError("There is no such image");
         return false;
     }
 
-    char header[54];
-    file.read(header, 54);
-
-    m_width = *(int *)&header[18];
-    m_height = *(int *)&header[22];
-
-    int bpp = *(short *)&header[28];
-
-    if (bpp != 24)
+    Header header;
+    if (!parseHeader(file.data(), file.size(), header))
     {
-        std::cout << "No format" << std::endl;
+        reportError("No format");
         return false;
     }
 
-    m_raw_image.resize(m_height, std::vector<Pixel>(m_width));
+    const unsigned char *pixels = file.data() + header.pixelOffset;
+    size_t available = file.size() - header.pixelOffset;
 
-    for (int y = m_height - 1; y >= 0; --y)
+    if (header.compression == COMPRESSION_RLE8)
     {
-        for (int x = 0; x < m_width; ++x)
+        if (!decodeRle8(pixels, available, header))
         {
-            unsigned char pixel[3];
-            file.read(reinterpret_cast<char *>(pixel), 3);
-
-            m_raw_image[y][x].red = pixel[2];
-            m_raw_image[y][x].green = pixel[1];
-            m_raw_image[y][x].blue = pixel[0];
-
-            // int brightness = (pixel[0] + pixel[1] + pixel[2]) / 3;
-            // m_image[y][x] = brightness;
+            reportError("The image is damaged");
+            return false;
         }
+        return true;
     }
 
+    // every stored row is padded to a multiple of 4 bytes, the last one may miss its padding
+    size_t rowBytes = (static_cast<size_t>(header.width) * header.bitsPerPixel + 7) / 8;
+    size_t stride = (static_cast<size_t>(header.width) * header.bitsPerPixel + 31) / 32 * 4;
+    if (available < stride * (header.height - 1) + rowBytes)
+    {
+        reportError("The image is damaged");
+        return false;
+    }
+
+    if (header.bitsPerPixel >= 24)
+        decodeTrueColor(pixels, stride, header);
+    else
+        decodeIndexed(pixels, stride, header);
+
     return true;
 }
@@ -2,6 +2,7 @@
 #define BMPIMAGE_H
 
 #include "image.hpp"
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -10,9 +11,86 @@
  *
  * This class inherits from the base Image class and provides functionality
  * to load and process BMP image files.
+ *
+ * Supported are uncompressed 1, 4, 8, 24 and 32 bit images, RLE8 compressed 8 bit images
+ * and 32 bit images with byte aligned bit fields, stored bottom-up or top-down.
  */
 class BmpImage : public Image
 {
+    /**
+     * @struct Header
+     * @brief The fields of the BMP file and info headers the decoder needs.
+     */
+    struct Header
+    {
+        uint32_t pixelOffset = 0;         /**< The offset of the pixel array in the file (bfOffBits). */
+        uint32_t infoSize = 0;            /**< The size of the info header. */
+        int width = 0;                    /**< The width of the image. */
+        int height = 0;                   /**< The height of the image, always positive. */
+        bool topDown = false;             /**< Whether the first stored row is the top one. */
+        int bitsPerPixel = 0;             /**< The number of bits per pixel. */
+        uint32_t compression = 0;         /**< The compression method. */
+        int channelOffset[3] = {2, 1, 0}; /**< The byte offsets of red, green and blue in a pixel. */
+        std::vector<Pixel> palette;       /**< The color table of indexed images, always 256 entries. */
+    };
+
+    /**
+     * @brief Parse the headers and the color table.
+     * @param data The content of the file.
+     * @param size The size of the file.
+     * @param header The parsed header.
+     * @return True if the image is in a supported format, false otherwise.
+     */
+    static bool parseHeader(const unsigned char *data, size_t size, Header &header);
+
+    /**
+     * @brief Decode uncompressed 24 or 32 bit rows.
+     * @param pixels The first stored row.
+     * @param stride The distance between two stored rows in bytes.
+     * @param header The parsed header.
+     */
+    void decodeTrueColor(const unsigned char *pixels, size_t stride, const Header &header);
+
+    /**
+     * @brief Decode uncompressed 1, 4 or 8 bit indexed rows.
+     * @param pixels The first stored row.
+     * @param stride The distance between two stored rows in bytes.
+     * @param header The parsed header.
+     */
+    void decodeIndexed(const unsigned char *pixels, size_t stride, const Header &header);
+
+    /**
+     * @brief Decode RLE8 compressed rows.
+     * @param pixels The first byte of the compressed data.
+     * @param size The size of the compressed data.
+     * @param header The parsed header.
+     * @return True if the data is valid, false otherwise.
+     */
+    bool decodeRle8(const unsigned char *pixels, size_t size, const Header &header);
+
+    /**
+     * @brief Prepare the image planes for indexed rows.
+     * @param header The parsed header.
+     * @param greyOfIndex The table to fill with the grey value of every palette entry.
+     *
+     * In streaming mode indexed rows go through this table straight to the grey plane.
+     */
+    void beginIndexedRows(const Header &header, unsigned char *greyOfIndex);
+
+    /**
+     * @brief Store a row of palette indices.
+     * @param y The index of the row in the image.
+     * @param indices The palette indices, one byte per pixel.
+     * @param header The parsed header.
+     * @param greyOfIndex The grey value of every palette entry.
+     */
+    void storeIndexedRow(int y, const unsigned char *indices, const Header &header, const unsigned char *greyOfIndex);
+
+    /**
+     * @brief Finish storing indexed rows.
+     */
+    void endIndexedRows();
+
 public:
     /**
      * @brief Load a BMP image from a file.
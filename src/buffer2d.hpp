@@ -0,0 +1,246 @@
+#ifndef BUFFER2D_H
+#define BUFFER2D_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @class Buffer2DView
+ * @brief A non-owning view of a rectangle in a strided 2D buffer.
+ *
+ * The view does not own the memory, it is only valid as long as the buffer it was taken from.
+ */
+template <typename T>
+class Buffer2DView
+{
+    T *m_data;       /**< The first element of the first row. */
+    int m_width;     /**< The width of the view in elements. */
+    int m_height;    /**< The height of the view in rows. */
+    size_t m_stride; /**< The distance between two rows in elements. */
+
+public:
+    /**
+     * @brief Create a view.
+     * @param data The first element of the first row.
+     * @param width The width in elements.
+     * @param height The height in rows.
+     * @param stride The distance between two rows in elements.
+     */
+    Buffer2DView(T *data = nullptr, int width = 0, int height = 0, size_t stride = 0)
+        : m_data(data), m_width(width), m_height(height), m_stride(stride) {}
+
+    /**
+     * @brief Create a read-only view from a writable one.
+     * @param other The writable view.
+     */
+    template <typename U, typename = typename std::enable_if<std::is_same<const U, T>::value && !std::is_same<U, T>::value>::type>
+    Buffer2DView(const Buffer2DView<U> &other)
+        : m_data(other.row(0)), m_width(other.width()), m_height(other.height()), m_stride(other.stride()) {}
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    size_t stride() const { return m_stride; }
+    bool empty() const { return m_width == 0 || m_height == 0; }
+
+    /**
+     * @brief Get the pointer to a row.
+     * @param y The row index.
+     * @return The pointer to the first element of the row, the row has width() elements.
+     */
+    T *row(int y) const { return m_data + y * m_stride; }
+
+    /**
+     * @brief Get one element.
+     * @param x The column index.
+     * @param y The row index.
+     * @return The reference to the element.
+     */
+    T &operator()(int x, int y) const { return m_data[y * m_stride + x]; }
+
+    /**
+     * @brief Get a view of a rectangle inside this view.
+     * @param x The left column of the rectangle.
+     * @param y The top row of the rectangle.
+     * @param width The width of the rectangle.
+     * @param height The height of the rectangle.
+     * @return The view of the rectangle, sharing the memory of this view.
+     */
+    Buffer2DView view(int x, int y, int width, int height) const
+    {
+        return Buffer2DView(m_data + y * m_stride + x, width, height, m_stride);
+    }
+};
+
+/**
+ * @class Buffer2D
+ * @brief A contiguous 2D buffer with aligned rows.
+ *
+ * All rows live in one allocation. Every row starts on a ROW_ALIGNMENT byte boundary,
+ * so the distance between two rows (the stride) can be larger than the width.
+ * The element type has to be trivially copyable, new buffers are zero filled.
+ */
+template <typename T>
+class Buffer2D
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Buffer2D elements must be trivially copyable");
+
+public:
+    /** The alignment of every row in bytes. */
+    static constexpr size_t ROW_ALIGNMENT = 64;
+
+private:
+    T *m_data = nullptr; /**< The first element of the first row. */
+    int m_width = 0;     /**< The width of the buffer in elements. */
+    int m_height = 0;    /**< The height of the buffer in rows. */
+    size_t m_stride = 0; /**< The distance between two rows in elements. */
+
+    /**
+     * @brief Get the stride for a width.
+     * @param width The width in elements.
+     * @return The smallest stride not below width which keeps every row aligned.
+     */
+    static size_t strideFor(int width)
+    {
+        size_t a = ROW_ALIGNMENT, b = sizeof(T);
+        while (b)
+        {
+            size_t t = a % b;
+            a = b;
+            b = t;
+        }
+        size_t step = ROW_ALIGNMENT / a;
+        return (static_cast<size_t>(width) + step - 1) / step * step;
+    }
+
+    void allocate(int width, int height)
+    {
+        m_width = width;
+        m_height = height;
+        m_stride = strideFor(width);
+        size_t bytes = m_stride * sizeof(T) * height;
+        m_data = nullptr;
+        if (bytes)
+        {
+            m_data = static_cast<T *>(std::aligned_alloc(ROW_ALIGNMENT, bytes));
+            if (!m_data)
+                throw std::bad_alloc();
+            memset(static_cast<void *>(m_data), 0, bytes);
+        }
+    }
+
+public:
+    Buffer2D() = default;
+
+    /**
+     * @brief Create a zero filled buffer.
+     * @param width The width in elements.
+     * @param height The height in rows.
+     */
+    Buffer2D(int width, int height) { allocate(width, height); }
+
+    Buffer2D(const Buffer2D &other)
+    {
+        allocate(other.m_width, other.m_height);
+        if (m_data)
+            memcpy(static_cast<void *>(m_data), other.m_data, m_stride * sizeof(T) * m_height);
+    }
+
+    Buffer2D(Buffer2D &&other) noexcept
+        : m_data(other.m_data), m_width(other.m_width), m_height(other.m_height), m_stride(other.m_stride)
+    {
+        other.m_data = nullptr;
+        other.m_width = other.m_height = 0;
+        other.m_stride = 0;
+    }
+
+    Buffer2D &operator=(Buffer2D other) noexcept
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_width, other.m_width);
+        std::swap(m_height, other.m_height);
+        std::swap(m_stride, other.m_stride);
+        return *this;
+    }
+
+    ~Buffer2D() { std::free(m_data); }
+
+    /**
+     * @brief Change the size of the buffer.
+     * @param width The new width in elements.
+     * @param height The new height in rows.
+     *
+     * If the size changes, the buffer is reallocated and zero filled, otherwise the content is kept.
+     */
+    void resize(int width, int height)
+    {
+        if (width == m_width && height == m_height)
+            return;
+        std::free(m_data);
+        allocate(width, height);
+    }
+
+    /**
+     * @brief Release the memory of the buffer.
+     */
+    void clear() { resize(0, 0); }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    size_t stride() const { return m_stride; }
+    bool empty() const { return m_width == 0 || m_height == 0; }
+
+    /**
+     * @brief Get the pointer to a row.
+     * @param y The row index.
+     * @return The pointer to the first element of the row, the row has width() elements.
+     */
+    T *row(int y) { return m_data + y * m_stride; }
+    const T *row(int y) const { return m_data + y * m_stride; }
+
+    /**
+     * @brief Get one element.
+     * @param x The column index.
+     * @param y The row index.
+     * @return The reference to the element.
+     */
+    T &operator()(int x, int y) { return m_data[y * m_stride + x]; }
+    const T &operator()(int x, int y) const { return m_data[y * m_stride + x]; }
+
+    /**
+     * @brief Set every element of the buffer.
+     * @param value The value to set.
+     */
+    void fill(const T &value)
+    {
+        for (int y = 0; y < m_height; ++y)
+        {
+            T *line = row(y);
+            for (int x = 0; x < m_width; ++x)
+                line[x] = value;
+        }
+    }
+
+    /**
+     * @brief Get a view of the whole buffer.
+     * @return The view.
+     */
+    Buffer2DView<T> view() { return Buffer2DView<T>(m_data, m_width, m_height, m_stride); }
+    Buffer2DView<const T> view() const { return Buffer2DView<const T>(m_data, m_width, m_height, m_stride); }
+
+    /**
+     * @brief Get a view of a rectangle of the buffer.
+     * @param x The left column of the rectangle.
+     * @param y The top row of the rectangle.
+     * @param width The width of the rectangle.
+     * @param height The height of the rectangle.
+     * @return The view of the rectangle.
+     */
+    Buffer2DView<T> view(int x, int y, int width, int height) { return view().view(x, y, width, height); }
+    Buffer2DView<const T> view(int x, int y, int width, int height) const { return view().view(x, y, width, height); }
+};
+
+#endif
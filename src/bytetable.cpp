@@ -0,0 +1,102 @@
+/**
+ * @file bytetable.cpp
+ * @brief Implementation of the ByteTable row kernels.
+ */
+
+#include "bytetable.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTETABLE_X86 1
+#endif
+
+namespace
+{
+    void mapRowScalar(const unsigned char *table, const unsigned char *source, unsigned char *target, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            target[i] = table[source[i]];
+        }
+    }
+
+#ifdef BYTETABLE_X86
+    /**
+     * @brief SSSE3 kernel, 16 bytes per step.
+     *
+     * The table is 16 slices of 16 entries. The low nibble of a byte shuffles every
+     * slice, the high nibble selects the slice the entry is taken from.
+     */
+    __attribute__((target("ssse3"))) void mapRowSsse3(const unsigned char *table, const unsigned char *source, unsigned char *target, size_t count)
+    {
+        __m128i slices[16];
+        for (int k = 0; k < 16; ++k)
+            slices[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(table + 16 * k));
+        const __m128i lowNibble = _mm_set1_epi8(0x0F);
+
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+            __m128i low = _mm_and_si128(values, lowNibble);
+            __m128i high = _mm_and_si128(_mm_srli_epi16(values, 4), lowNibble);
+
+            __m128i result = _mm_setzero_si128();
+            for (int k = 0; k < 16; ++k)
+            {
+                __m128i inSlice = _mm_cmpeq_epi8(high, _mm_set1_epi8(static_cast<char>(k)));
+                result = _mm_or_si128(result, _mm_and_si128(inSlice, _mm_shuffle_epi8(slices[k], low)));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(target + i), result);
+        }
+        mapRowScalar(table, source + i, target + i, count - i);
+    }
+
+    /**
+     * @brief AVX2 kernel, 32 bytes per step, the same slicing as the SSSE3 one.
+     */
+    __attribute__((target("avx2"))) void mapRowAvx2(const unsigned char *table, const unsigned char *source, unsigned char *target, size_t count)
+    {
+        __m256i slices[16];
+        for (int k = 0; k < 16; ++k)
+            slices[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(table + 16 * k)));
+        const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i));
+            __m256i low = _mm256_and_si256(values, lowNibble);
+            __m256i high = _mm256_and_si256(_mm256_srli_epi16(values, 4), lowNibble);
+
+            __m256i result = _mm256_setzero_si256();
+            for (int k = 0; k < 16; ++k)
+            {
+                __m256i inSlice = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(static_cast<char>(k)));
+                result = _mm256_or_si256(result, _mm256_and_si256(inSlice, _mm256_shuffle_epi8(slices[k], low)));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(target + i), result);
+        }
+        mapRowScalar(table, source + i, target + i, count - i);
+    }
+#endif
+
+    typedef void (*MapKernel)(const unsigned char *, const unsigned char *, unsigned char *, size_t);
+
+    MapKernel mapKernel()
+    {
+#ifdef BYTETABLE_X86
+        static const MapKernel selected = (__builtin_cpu_init(), __builtin_cpu_supports("avx2")    ? mapRowAvx2
+                                                                 : __builtin_cpu_supports("ssse3") ? mapRowSsse3
+                                                                 : mapRowScalar);
+        return selected;
+#else
+        return mapRowScalar;
+#endif
+    }
+}
+
+void ByteTable::mapRow(const unsigned char *table, const unsigned char *source, unsigned char *target, size_t count)
+{
+    mapKernel()(table, source, target, count);
+}
@@ -0,0 +1,26 @@
+#ifndef BYTETABLE_H
+#define BYTETABLE_H
+
+#include <cstddef>
+
+/**
+ * @class ByteTable
+ * @brief Mapping of byte rows through a 256-entry table.
+ *
+ * With SSSE3 or AVX2 the table is looked up with byte shuffles, 16 or 32 bytes per step,
+ * otherwise byte by byte.
+ */
+class ByteTable
+{
+public:
+    /**
+     * @brief Map a row of bytes through a table.
+     * @param table The 256 entries of the table.
+     * @param source The bytes to map.
+     * @param target The output buffer, it can be the source buffer.
+     * @param count The number of bytes.
+     */
+    static void mapRow(const unsigned char *table, const unsigned char *source, unsigned char *target, size_t count);
+};
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file cellencoding.cpp
+ * @brief Implementation of the CellEncoding class.
+ */
+
+#include "cellencoding.hpp"
+
+namespace
+{
+    // the bit of the left and the right dot in every row of a Braille cell
+    const unsigned char LEFT_DOT[4] = {0x01, 0x02, 0x04, 0x40};
+    const unsigned char RIGHT_DOT[4] = {0x08, 0x10, 0x20, 0x80};
+
+    // the code points of the half-block cells, indexed by the dark halves
+    const unsigned HALF_BLOCKS[4] = {' ', 0x2580, 0x2584, 0x2588};
+
+    int encodeUtf8(unsigned codePoint, char *bytes)
+    {
+        if (codePoint < 0x80)
+        {
+            bytes[0] = static_cast<char>(codePoint);
+            return 1;
+        }
+        // the code points used here are all below U+10000
+        bytes[0] = static_cast<char>(0xE0 | codePoint >> 12);
+        bytes[1] = static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+        bytes[2] = static_cast<char>(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+}
+
+CellEncoding::CellEncoding(Mode mode) : m_mode(mode), m_bytes(), m_length(), m_blank(mode == MODE_ASCII || mode == MODE_SHAPE ? ' ' : 0)
+{
+    for (unsigned value = 0; value < 256; ++value)
+    {
+        unsigned codePoint = value;
+        if (mode == MODE_HALF_BLOCK)
+            codePoint = HALF_BLOCKS[value & 3];
+        else if (mode == MODE_BRAILLE)
+            codePoint = 0x2800 + value;
+        m_length[value] = static_cast<unsigned char>(encodeUtf8(codePoint, m_bytes[value]));
+    }
+}
+
+const CellEncoding &CellEncoding::get(Mode mode)
+{
+    static const CellEncoding encodings[] = {CellEncoding(MODE_ASCII), CellEncoding(MODE_HALF_BLOCK), CellEncoding(MODE_BRAILLE),
+                                                     CellEncoding(MODE_SHAPE)};
+    return encodings[mode];
+}
+
+void CellEncoding::appendRow(const char *cells, int count, std::string &frame) const
+{
+    if (isAscii())
+    {
+        frame.append(cells, count);
+        return;
+    }
+    for (int x = 0; x < count; ++x)
+    {
+        append(cells[x], frame);
+    }
+}
+
+void CellEncoding::halfBlockRow(const unsigned char *upper, const unsigned char *lower, char *cells, int count)
+{
+    for (int x = 0; x < count; ++x)
+    {
+        cells[x] = static_cast<char>((upper[x] < THRESHOLD) | (lower[x] < THRESHOLD) << 1);
+    }
+}
+
+void CellEncoding::brailleRow(const unsigned char *const rows[4], char *cells, int count)
+{
+    // one pass per pixel row, every pass ORs two dot bits into each cell
+    for (int x = 0; x < count; ++x)
+    {
+        cells[x] = 0;
+    }
+    for (int row = 0; row < 4; ++row)
+    {
+        const unsigned char *grey = rows[row];
+        const unsigned char left = LEFT_DOT[row], right = RIGHT_DOT[row];
+        for (int x = 0; x < count; ++x)
+        {
+            cells[x] = static_cast<char>(cells[x] | (grey[2 * x] < THRESHOLD ? left : 0) | (grey[2 * x + 1] < THRESHOLD ? right : 0));
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef CELLENCODING_H
+#define CELLENCODING_H
+
+#include <string>
+
+/**
+ * @class CellEncoding
+ * @brief How the cells of a render mode are written to the terminal.
+ *
+ * A cell is one byte: a character in ASCII mode, the lit halves in half-block mode and the dot
+ * pattern in Braille mode. Every mode has a table with the UTF-8 bytes of all 256 cell values,
+ * so writing a cell is a table lookup.
+ *
+ * A cell covers subColumns x subRows pixels of the scaled grey plane: 1 x 1 in ASCII mode,
+ * 1 x 2 in half-block mode (upper and lower half), 2 x 4 in Braille mode and 4 x 8 in shape mode.
+ */
+class CellEncoding
+{
+public:
+    /**
+     * @enum Mode
+     * @brief The kind of cells.
+     */
+    enum Mode
+    {
+        MODE_ASCII,      /**< One glyph of the transition string per cell. */
+        MODE_HALF_BLOCK, /**< The upper and lower half of a cell, as ' ', U+2580, U+2584 or U+2588. */
+        MODE_BRAILLE,    /**< A 2 x 4 dot pattern per cell, as U+2800 + pattern. */
+        MODE_SHAPE       /**< One glyph of the transition string per cell, matched to the shape of its 4 x 8 pixels. */
+    };
+
+    /** The grey values below this are dark pixels, shown as a lit half or a raised dot. */
+    static constexpr unsigned char THRESHOLD = 128;
+
+private:
+    Mode m_mode;                    /**< The mode of the cells. */
+    char m_bytes[256][3];           /**< The UTF-8 bytes of every cell value. */
+    unsigned char m_length[256];    /**< The number of bytes of every cell value. */
+    unsigned char m_blank;          /**< The cell value which shows nothing. */
+
+    /**
+     * @brief Build the table of a mode.
+     * @param mode The mode.
+     */
+    explicit CellEncoding(Mode mode);
+
+public:
+    /**
+     * @brief Get the encoding of a mode.
+     * @param mode The mode.
+     * @return The encoding, built once.
+     */
+    static const CellEncoding &get(Mode mode);
+
+    Mode mode() const { return m_mode; }
+    int subColumns() const { return m_mode == MODE_SHAPE ? 4 : m_mode == MODE_BRAILLE ? 2 : 1; }
+    int subRows() const { return m_mode == MODE_SHAPE ? 8 : m_mode == MODE_BRAILLE ? 4 : m_mode == MODE_HALF_BLOCK ? 2 : 1; }
+    bool isAscii() const { return m_mode == MODE_ASCII || m_mode == MODE_SHAPE; }
+
+    /**
+     * @brief Check whether a cell shows nothing, so its color does not matter.
+     * @param cell The cell value.
+     * @return True for a blank cell.
+     */
+    bool isBlank(char cell) const { return static_cast<unsigned char>(cell) == m_blank; }
+
+    /**
+     * @brief Append the bytes of a cell.
+     * @param cell The cell value.
+     * @param frame The string to append to.
+     */
+    void append(char cell, std::string &frame) const
+    {
+        const unsigned char value = static_cast<unsigned char>(cell);
+        frame.append(m_bytes[value], m_length[value]);
+    }
+
+    /**
+     * @brief Append the bytes of a row of cells.
+     * @param cells The cell values.
+     * @param count The number of cells.
+     * @param frame The string to append to.
+     */
+    void appendRow(const char *cells, int count, std::string &frame) const;
+
+    /**
+     * @brief Get the most bytes a cell takes.
+     * @return 1 for glyphs, 3 otherwise.
+     */
+    int maxBytes() const { return isAscii() ? 1 : 3; }
+
+    /**
+     * @brief Compute half-block cells from two rows of grey values.
+     * @param upper The grey values of the upper halves.
+     * @param lower The grey values of the lower halves.
+     * @param cells The cells, bit 0 set for a dark upper half and bit 1 for a dark lower half.
+     * @param count The number of cells.
+     */
+    static void halfBlockRow(const unsigned char *upper, const unsigned char *lower, char *cells, int count);
+
+    /**
+     * @brief Compute Braille cells from four rows of grey values.
+     * @param rows The four rows, each with 2 * count grey values.
+     * @param cells The dot patterns, a bit set for every dark pixel.
+     * @param count The number of cells.
+     *
+     * The bits follow the Unicode dot numbering: the left column of the first three rows is
+     * bits 0-2, the right column bits 3-5, and the last row bits 6 (left) and 7 (right).
+     */
+    static void brailleRow(const unsigned char *const rows[4], char *cells, int count);
+};
+
+#endif
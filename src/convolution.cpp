@@ -0,0 +1,409 @@
+/**
+ * @file convolution.cpp
+ * @brief Implementation of the Convolution class.
+ */
+
+#include "convolution.hpp"
+#include "threadpool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CONVOLUTION_X86 1
+#endif
+
+namespace
+{
+    void weightedSumScalar(const unsigned char *const *inputs, const uint16_t *weights, int taps, unsigned char *output, int count)
+    {
+        for (int x = 0; x < count; ++x)
+        {
+            unsigned sum = 0;
+            for (int t = 0; t < taps; ++t)
+                sum += (inputs[t][x] << 8) * static_cast<unsigned>(weights[t]) >> 16;
+            output[x] = static_cast<unsigned char>((sum + 128) >> 8);
+        }
+    }
+
+#ifdef CONVOLUTION_X86
+    /**
+     * @brief SSE2 kernel, 16 pixels per step.
+     *
+     * A byte unpacked above a zero byte is the pixel in 8.8 fixed point, the high half of its
+     * product with a weight is the weighted pixel in 8.8. The sum of all taps stays below 65536.
+     */
+    __attribute__((target("sse2"))) void weightedSumSse2(const unsigned char *const *inputs, const uint16_t *weights, int taps, unsigned char *output, int count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i half = _mm_set1_epi16(128);
+        int x = 0;
+        for (; x + 16 <= count; x += 16)
+        {
+            __m128i low = _mm_setzero_si128(), high = _mm_setzero_si128();
+            for (int t = 0; t < taps; ++t)
+            {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(inputs[t] + x));
+                const __m128i weight = _mm_set1_epi16(static_cast<short>(weights[t]));
+                low = _mm_add_epi16(low, _mm_mulhi_epu16(_mm_unpacklo_epi8(zero, bytes), weight));
+                high = _mm_add_epi16(high, _mm_mulhi_epu16(_mm_unpackhi_epi8(zero, bytes), weight));
+            }
+            low = _mm_srli_epi16(_mm_add_epi16(low, half), 8);
+            high = _mm_srli_epi16(_mm_add_epi16(high, half), 8);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(output + x), _mm_packus_epi16(low, high));
+        }
+        if (x < count)
+        {
+            const unsigned char *rest[2 * Convolution::MAX_RADIUS + 1];
+            for (int t = 0; t < taps; ++t)
+                rest[t] = inputs[t] + x;
+            weightedSumScalar(rest, weights, taps, output + x, count - x);
+        }
+    }
+
+    /**
+     * @brief AVX2 kernel, 32 pixels per step, the same arithmetic as the SSE2 one.
+     *
+     * Unpacking and packing both work within the 128-bit lanes, so the pixels keep their order.
+     */
+    __attribute__((target("avx2"))) void weightedSumAvx2(const unsigned char *const *inputs, const uint16_t *weights, int taps, unsigned char *output, int count)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i half = _mm256_set1_epi16(128);
+        int x = 0;
+        for (; x + 32 <= count; x += 32)
+        {
+            __m256i low = _mm256_setzero_si256(), high = _mm256_setzero_si256();
+            for (int t = 0; t < taps; ++t)
+            {
+                const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inputs[t] + x));
+                const __m256i weight = _mm256_set1_epi16(static_cast<short>(weights[t]));
+                low = _mm256_add_epi16(low, _mm256_mulhi_epu16(_mm256_unpacklo_epi8(zero, bytes), weight));
+                high = _mm256_add_epi16(high, _mm256_mulhi_epu16(_mm256_unpackhi_epi8(zero, bytes), weight));
+            }
+            low = _mm256_srli_epi16(_mm256_add_epi16(low, half), 8);
+            high = _mm256_srli_epi16(_mm256_add_epi16(high, half), 8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + x), _mm256_packus_epi16(low, high));
+        }
+        if (x < count)
+        {
+            const unsigned char *rest[2 * Convolution::MAX_RADIUS + 1];
+            for (int t = 0; t < taps; ++t)
+                rest[t] = inputs[t] + x;
+            weightedSumSse2(rest, weights, taps, output + x, count - x);
+        }
+    }
+#endif
+
+    typedef void (*SumKernel)(const unsigned char *const *, const uint16_t *, int, unsigned char *, int);
+
+    SumKernel sumKernel()
+    {
+#ifdef CONVOLUTION_X86
+        static const SumKernel selected = (__builtin_cpu_init(), __builtin_cpu_supports("avx2")   ? weightedSumAvx2
+                                                                 : __builtin_cpu_supports("sse2") ? weightedSumSse2
+                                                                 : weightedSumScalar);
+        return selected;
+#else
+        return weightedSumScalar;
+#endif
+    }
+
+    /**
+     * @brief Compute the weights of a Gaussian kernel with sigma = radius / 2.
+     * @return The 2 * radius + 1 weights, summing to 65536.
+     */
+    std::vector<uint16_t> gaussianWeights(int radius)
+    {
+        const double sigma = radius / 2.0;
+        std::vector<double> exact(2 * radius + 1);
+        double total = 0;
+        for (int t = -radius; t <= radius; ++t)
+            total += exact[t + radius] = std::exp(-t * t / (2 * sigma * sigma));
+
+        // the center takes the rounding error, it is the largest weight and always below 65536
+        std::vector<uint16_t> weights(2 * radius + 1);
+        int sum = 0;
+        for (int t = 0; t < 2 * radius + 1; ++t)
+        {
+            if (t != radius)
+                sum += weights[t] = static_cast<uint16_t>(std::lround(exact[t] / total * 65536));
+        }
+        weights[radius] = static_cast<uint16_t>(65536 - sum);
+        return weights;
+    }
+
+    /**
+     * @brief Get the number of rows of a band of a filter with halo rows.
+     * @param width The width of the plane.
+     * @param radius The number of halo rows above and below a band.
+     * @param work The work per pixel of a row.
+     */
+    int bandGrain(int width, int radius, int work)
+    {
+        // a band is at least four times as high as its halo
+        return std::max(ThreadPool::grainFor(static_cast<long long>(width) * work), 8 * radius);
+    }
+
+    /**
+     * @brief Turn blurred pixels into the unsharp mask 2 * original - blurred.
+     */
+    void unsharpRow(const unsigned char *original, unsigned char *blurred, int count)
+    {
+        int x = 0;
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= count; x += 16)
+        {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(original + x));
+            const __m128i blur = _mm_loadu_si128(reinterpret_cast<const __m128i *>(blurred + x));
+            const __m128i low = _mm_unpacklo_epi8(pixels, zero), high = _mm_unpackhi_epi8(pixels, zero);
+            const __m128i sharpLow = _mm_sub_epi16(_mm_add_epi16(low, low), _mm_unpacklo_epi8(blur, zero));
+            const __m128i sharpHigh = _mm_sub_epi16(_mm_add_epi16(high, high), _mm_unpackhi_epi8(blur, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(blurred + x), _mm_packus_epi16(sharpLow, sharpHigh));
+        }
+#endif
+        for (; x < count; ++x)
+        {
+            blurred[x] = static_cast<unsigned char>(std::min(255, std::max(0, 2 * original[x] - blurred[x])));
+        }
+    }
+
+    /**
+     * @brief Gaussian blur, with the unsharp mask applied to the blurred rows if sharpen is set.
+     */
+    void gaussian(int radius, bool sharpen, Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target)
+    {
+        const int width = source.width(), height = source.height();
+        const int taps = 2 * radius + 1;
+        const std::vector<uint16_t> weights = gaussianWeights(radius);
+        const SumKernel sum = sumKernel();
+
+        ThreadPool::shared().parallelFor(height, bandGrain(width, radius, 2 * taps), [&](int first, int last)
+        {
+            // the ring holds the horizontally filtered rows y - radius to y + radius of one tile
+            std::vector<unsigned char> ring(static_cast<size_t>(taps) * Convolution::TILE);
+            std::vector<unsigned char> padded(Convolution::TILE + 2 * radius);
+            std::vector<const unsigned char *> rows(taps);
+            auto slot = [&](int y) { return ring.data() + static_cast<size_t>((y % taps + taps) % taps) * Convolution::TILE; };
+
+            for (int left = 0; left < width; left += Convolution::TILE)
+            {
+                const int count = std::min(Convolution::TILE, width - left);
+                // the columns of the tile with the halo, the border repeated outside the plane
+                const int from = std::max(0, left - radius), to = std::min(width, left + count + radius);
+                for (int y = first - radius; y < last + radius; ++y)
+                {
+                    const unsigned char *row = source.row(std::min(std::max(y, 0), height - 1));
+                    unsigned char *pad = padded.data();
+                    const int before = from - (left - radius), after = left + count + radius - to;
+                    memset(pad, row[0], before);
+                    memcpy(pad + before, row + from, to - from);
+                    memset(pad + before + (to - from), row[width - 1], after);
+
+                    for (int t = 0; t < taps; ++t)
+                        rows[t] = pad + t;
+                    sum(rows.data(), weights.data(), taps, slot(y), count);
+
+                    const int out = y - radius;
+                    if (out < first)
+                        continue;
+                    for (int t = 0; t < taps; ++t)
+                        rows[t] = slot(out - radius + t);
+                    unsigned char *blurred = target.row(out) + left;
+                    sum(rows.data(), weights.data(), taps, blurred, count);
+
+                    if (sharpen)
+                        unsharpRow(source.row(out) + left, blurred, count);
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief Add the pixels of an entering row to column sums and subtract those of a leaving row.
+     */
+    void slideColumns(uint16_t *columns, const unsigned char *entering, const unsigned char *leaving, int width)
+    {
+        int x = 0;
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= width; x += 16)
+        {
+            const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(entering + x));
+            const __m128i out = _mm_loadu_si128(reinterpret_cast<const __m128i *>(leaving + x));
+            __m128i *sums = reinterpret_cast<__m128i *>(columns + x);
+            _mm_storeu_si128(sums, _mm_sub_epi16(_mm_add_epi16(_mm_loadu_si128(sums), _mm_unpacklo_epi8(in, zero)), _mm_unpacklo_epi8(out, zero)));
+            _mm_storeu_si128(sums + 1, _mm_sub_epi16(_mm_add_epi16(_mm_loadu_si128(sums + 1), _mm_unpackhi_epi8(in, zero)), _mm_unpackhi_epi8(out, zero)));
+        }
+#endif
+        for (; x < width; ++x)
+        {
+            columns[x] = static_cast<uint16_t>(columns[x] + entering[x] - leaving[x]);
+        }
+    }
+
+    void box(int radius, Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target)
+    {
+        const int width = source.width(), height = source.height();
+        const int taps = 2 * radius + 1;
+        const float scale = 1.0f / (taps * taps);
+        auto row = [&](int y) { return source.row(std::min(std::max(y, 0), height - 1)); };
+
+        ThreadPool::shared().parallelFor(height, bandGrain(width, radius, 4), [&](int first, int last)
+        {
+            // the sums of the rows y - radius to y + radius per column, at most 129 * 255, with the
+            // border columns repeated radius times on both sides
+            std::vector<uint16_t> padded(width + 2 * radius + 1, 0);
+            uint16_t *columns = padded.data() + radius;
+            for (int y = first - radius; y <= first + radius; ++y)
+            {
+                const unsigned char *pixels = row(y);
+                for (int x = 0; x < width; ++x)
+                    columns[x] = static_cast<uint16_t>(columns[x] + pixels[x]);
+            }
+
+            for (int y = first; y < last; ++y)
+            {
+                std::fill(padded.begin(), padded.begin() + radius, columns[0]);
+                std::fill(padded.begin() + radius + width, padded.end(), columns[width - 1]);
+
+                // a running sum along the row of column sums
+                unsigned sum = 0;
+                for (int i = 0; i < taps; ++i)
+                    sum += padded[i];
+                unsigned char *out = target.row(y);
+                for (int x = 0; x < width; ++x)
+                {
+                    out[x] = static_cast<unsigned char>(sum * scale + 0.5f);
+                    sum += padded[x + taps] - padded[x];
+                }
+
+                if (y + 1 < last)
+                    slideColumns(columns, row(y + radius + 1), row(y - radius), width);
+            }
+        });
+    }
+
+    /**
+     * @brief The Sobel magnitude and the Laplacian of a pixel from its 3 x 3 neighbourhood.
+     *
+     * The neighbourhood is the rows above, at and below the pixel, at the columns left, x and right.
+     */
+    inline unsigned char stencil(bool sobel, const unsigned char *above, const unsigned char *row, const unsigned char *below, int left, int x, int right)
+    {
+        if (sobel)
+        {
+            const int gx = (above[right] + 2 * row[right] + below[right]) - (above[left] + 2 * row[left] + below[left]);
+            const int gy = (below[left] + 2 * below[x] + below[right]) - (above[left] + 2 * above[x] + above[right]);
+            return static_cast<unsigned char>(std::min(255, (std::abs(gx) + std::abs(gy)) >> 2));
+        }
+        const int laplacian = 4 * row[x] - above[x] - below[x] - row[left] - row[right];
+        return static_cast<unsigned char>(std::min(255, std::abs(laplacian)));
+    }
+
+#if defined(__SSE2__)
+    inline __m128i absolute(__m128i v)
+    {
+        return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+    }
+
+    /**
+     * @brief The stencil of 8 pixels in 16-bit lanes.
+     */
+    inline __m128i stencil8(bool sobel, __m128i aboveLeft, __m128i above, __m128i aboveRight, __m128i left, __m128i center,
+                            __m128i right, __m128i belowLeft, __m128i below, __m128i belowRight)
+    {
+        if (sobel)
+        {
+            const __m128i gx = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(aboveRight, belowRight), _mm_slli_epi16(right, 1)),
+                                             _mm_add_epi16(_mm_add_epi16(aboveLeft, belowLeft), _mm_slli_epi16(left, 1)));
+            const __m128i gy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(belowLeft, belowRight), _mm_slli_epi16(below, 1)),
+                                             _mm_add_epi16(_mm_add_epi16(aboveLeft, aboveRight), _mm_slli_epi16(above, 1)));
+            return _mm_srli_epi16(_mm_add_epi16(absolute(gx), absolute(gy)), 2);
+        }
+        const __m128i neighbours = _mm_add_epi16(_mm_add_epi16(above, below), _mm_add_epi16(left, right));
+        return absolute(_mm_sub_epi16(_mm_slli_epi16(center, 2), neighbours));
+    }
+#endif
+
+    void edges(bool sobel, Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target)
+    {
+        const int width = source.width(), height = source.height();
+        ThreadPool::shared().parallelFor(height, ThreadPool::grainFor(width * 4), [&](int first, int last)
+        {
+            for (int y = first; y < last; ++y)
+            {
+                const unsigned char *above = source.row(std::max(y - 1, 0));
+                const unsigned char *row = source.row(y);
+                const unsigned char *below = source.row(std::min(y + 1, height - 1));
+                unsigned char *out = target.row(y);
+
+                out[0] = stencil(sobel, above, row, below, 0, 0, std::min(1, width - 1));
+                int x = 1;
+#if defined(__SSE2__)
+                // the interior 16 pixels at a time, the columns x - 1 and x + 1 are shifted loads
+                const __m128i zero = _mm_setzero_si128();
+                for (; x + 17 <= width; x += 16)
+                {
+                    __m128i lanes[9];
+                    const unsigned char *rows[3] = {above, row, below};
+                    for (int r = 0; r < 3; ++r)
+                        for (int c = 0; c < 3; ++c)
+                            lanes[3 * r + c] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[r] + x - 1 + c));
+
+                    __m128i low[9], high[9];
+                    for (int i = 0; i < 9; ++i)
+                    {
+                        low[i] = _mm_unpacklo_epi8(lanes[i], zero);
+                        high[i] = _mm_unpackhi_epi8(lanes[i], zero);
+                    }
+                    const __m128i resultLow = stencil8(sobel, low[0], low[1], low[2], low[3], low[4], low[5], low[6], low[7], low[8]);
+                    const __m128i resultHigh = stencil8(sobel, high[0], high[1], high[2], high[3], high[4], high[5], high[6], high[7], high[8]);
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_packus_epi16(resultLow, resultHigh));
+                }
+#endif
+                for (; x < width; ++x)
+                    out[x] = stencil(sobel, above, row, below, x - 1, x, std::min(x + 1, width - 1));
+            }
+        });
+    }
+}
+
+void Convolution::weightedSum(const unsigned char *const *inputs, const uint16_t *weights, int taps, unsigned char *output, int count)
+{
+    sumKernel()(inputs, weights, taps, output, count);
+}
+
+void Convolution::apply(Kind kind, int radius, Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target)
+{
+    if (source.empty())
+        return;
+    radius = std::min(std::max(radius, 0), MAX_RADIUS);
+
+    switch (kind)
+    {
+    case KIND_BOX_BLUR:
+        box(std::max(radius, 1), source, target);
+        break;
+    case KIND_GAUSSIAN_BLUR:
+    case KIND_SHARPEN:
+        gaussian(std::max(radius, 1), kind == KIND_SHARPEN, source, target);
+        break;
+    case KIND_SOBEL:
+    case KIND_LAPLACIAN:
+        if (radius > 0)
+        {
+            Buffer2D<unsigned char> blurred(source.width(), source.height());
+            gaussian(radius, false, source, blurred.view());
+            edges(kind == KIND_SOBEL, blurred.view(), target);
+        }
+        else
+        {
+            edges(kind == KIND_SOBEL, source, target);
+        }
+        break;
+    }
+}
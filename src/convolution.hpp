@@ -0,0 +1,63 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include "buffer2d.hpp"
+#include <cstdint>
+
+/**
+ * @class Convolution
+ * @brief Spatial filters of a grey plane: blur, sharpen and edge detection.
+ *
+ * The Gaussian kernels are separable: every band of rows runs a horizontal pass into a ring of
+ * 2 * radius + 1 filtered rows and a vertical pass from the ring into the target, over tiles of
+ * TILE columns so that the ring stays in the cache. Both passes are the same weighted sum of
+ * shifted rows (AVX2 where supported, SSE2 otherwise). The box blur keeps running sums along the
+ * rows and down the columns, so it costs the same for every radius. The edge detectors are
+ * 3 x 3 stencils after an optional Gaussian blur. Rows outside the plane repeat the border.
+ */
+class Convolution
+{
+public:
+    /**
+     * @enum Kind
+     * @brief The spatial filters.
+     */
+    enum Kind
+    {
+        KIND_BOX_BLUR,      /**< The mean of the (2 * radius + 1)^2 pixels around every pixel. */
+        KIND_GAUSSIAN_BLUR, /**< A Gaussian blur with sigma = radius / 2, cut off at the radius. */
+        KIND_SHARPEN,       /**< An unsharp mask: the pixel plus its difference to the Gaussian blur. */
+        KIND_SOBEL,         /**< The Sobel gradient magnitude, a step of contrast c gives c. */
+        KIND_LAPLACIAN      /**< The magnitude of the 4-neighbour Laplacian. */
+    };
+
+    /** The largest radius of a filter. */
+    static constexpr int MAX_RADIUS = 64;
+
+    /** The number of columns of a tile of the separable passes. */
+    static constexpr int TILE = 512;
+
+    /**
+     * @brief Filter a plane.
+     * @param kind The filter.
+     * @param radius The radius in pixels, 1 to MAX_RADIUS for the blurs and the sharpening,
+     *               0 to MAX_RADIUS for the edge detectors which blur first if it is not 0.
+     * @param source The source plane.
+     * @param target The target plane, of the same size and not overlapping the source.
+     */
+    static void apply(Kind kind, int radius, Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target);
+
+    /**
+     * @brief Compute a weighted sum of rows.
+     * @param inputs The rows, one per weight.
+     * @param weights The weights, in 1/65536, summing to 65536.
+     * @param taps The number of rows and weights.
+     * @param output The sums, rounded to grey values.
+     * @param count The number of pixels.
+     *
+     * Each product is taken in 8.8 fixed point, so the result is the same with every instruction set.
+     */
+    static void weightedSum(const unsigned char *const *inputs, const uint16_t *weights, int taps, unsigned char *output, int count);
+};
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * @file dither.cpp
+ * @brief Implementation of the Dither class.
+ */
+
+#include "dither.hpp"
+#include "bytetable.hpp"
+#include "threadpool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // the 8 x 8 Bayer matrix, every threshold 0 to 63 once
+    const unsigned char BAYER[8][8] = {
+        {0, 32, 8, 40, 2, 34, 10, 42},
+        {48, 16, 56, 24, 50, 18, 58, 26},
+        {12, 44, 4, 36, 14, 46, 6, 38},
+        {60, 28, 52, 20, 62, 30, 54, 22},
+        {3, 35, 11, 43, 1, 33, 9, 41},
+        {51, 19, 59, 27, 49, 17, 57, 25},
+        {15, 47, 7, 39, 13, 45, 5, 37},
+        {63, 31, 55, 23, 61, 29, 53, 21},
+    };
+
+    // error diffusion works in sixteenths of a grey value, the Floyd-Steinberg weights are 7, 3, 5 and 1
+    const int ONE = 16;
+    const int WHITE = 255 * ONE;
+
+    // rows of error diffusion publish their progress every this many pixels
+    const int BLOCK = 64;
+
+    /**
+     * @brief Get the threshold of a cell of the Bayer matrix scaled to a grey value, in (0, 255).
+     */
+    uint16_t threshold(int x, int y)
+    {
+        return static_cast<uint16_t>(((2 * BAYER[y & 7][x & 7] + 1) * 255 + 64) / 128);
+    }
+
+    /**
+     * @brief Build the table of the smallest grey value of every level.
+     *
+     * Level k starts at ceil(k * 255 / (levels - 1)), which a GlyphTable of as many glyphs maps to glyph k.
+     */
+    void levelGreys(int levels, unsigned char table[256])
+    {
+        for (int k = 0; k < 256; ++k)
+            table[k] = static_cast<unsigned char>(k < levels ? (k * 255 + levels - 2) / (levels - 1) : 255);
+    }
+
+    void diffuse(Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target, int levels)
+    {
+        const int width = source.width(), height = source.height();
+        unsigned char greys[256];
+        levelGreys(levels, greys);
+
+        // the nearest level of every clamped value and the exact value of every level
+        std::vector<unsigned char> nearest(WHITE + 1);
+        for (int value = 0; value <= WHITE; ++value)
+            nearest[value] = static_cast<unsigned char>((value * (levels - 1) + WHITE / 2) / WHITE);
+        std::vector<int> exact(levels);
+        for (int k = 0; k < levels; ++k)
+            exact[k] = (k * WHITE + (levels - 1) / 2) / (levels - 1);
+
+        // the errors carried into every row, with a pixel of padding on both sides
+        const size_t stride = static_cast<size_t>(width) + 2;
+        std::vector<int16_t> errors(stride * height);
+        std::vector<std::atomic<int>> progress(height);
+        for (auto &done : progress)
+            done.store(0, std::memory_order_relaxed);
+
+        // the rows are claimed in order, so the row above is always taken by a running thread
+        ThreadPool::shared().forEach(height, [&](int y)
+        {
+            const unsigned char *grey = source.row(y);
+            unsigned char *out = target.row(y);
+            const int16_t *carried = errors.data() + stride * y + 1;
+            int16_t *below = y + 1 < height ? errors.data() + stride * (y + 1) + 1 : nullptr;
+            int right = 0;
+            for (int first = 0; first < width; first += BLOCK)
+            {
+                const int last = std::min(width, first + BLOCK);
+                // the errors of pixel x are final when the row above has passed pixel x + 1
+                if (y > 0)
+                {
+                    const int needed = std::min(width, last + 1);
+                    while (progress[y - 1].load(std::memory_order_acquire) < needed)
+                        std::this_thread::yield();
+                }
+                for (int x = first; x < last; ++x)
+                {
+                    const int value = grey[x] * ONE + carried[x] + right;
+                    const int level = nearest[std::min(WHITE, std::max(0, value))];
+                    out[x] = greys[level];
+
+                    const int error = value - exact[level];
+                    right = error * 7 / 16;
+                    if (below)
+                    {
+                        const int left = error * 3 / 16, center = error * 5 / 16;
+                        below[x - 1] = static_cast<int16_t>(below[x - 1] + left);
+                        below[x] = static_cast<int16_t>(below[x] + center);
+                        below[x + 1] = static_cast<int16_t>(below[x + 1] + error - right - left - center);
+                    }
+                }
+                progress[y].store(last, std::memory_order_release);
+            }
+        });
+    }
+}
+
+void Dither::orderedRow(const unsigned char *grey, unsigned char *level, int count, int y, int levels)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    // 8 lanes of 16 bits are one row of the matrix: grey * (levels - 1) + threshold, divided by
+    // 255 as (value * 0x8081) >> 23, which is exact for all 16-bit values
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i scale = _mm_set1_epi16(static_cast<short>(levels - 1));
+    const __m128i reciprocal = _mm_set1_epi16(static_cast<short>(0x8081));
+    const __m128i thresholds = _mm_setr_epi16(threshold(0, y), threshold(1, y), threshold(2, y), threshold(3, y),
+                                              threshold(4, y), threshold(5, y), threshold(6, y), threshold(7, y));
+    for (; x + 16 <= count; x += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(grey + x));
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(bytes, zero), scale), thresholds);
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(bytes, zero), scale), thresholds);
+        low = _mm_srli_epi16(_mm_mulhi_epu16(low, reciprocal), 7);
+        high = _mm_srli_epi16(_mm_mulhi_epu16(high, reciprocal), 7);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(level + x), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; x < count; ++x)
+    {
+        level[x] = static_cast<unsigned char>((grey[x] * (levels - 1) + threshold(x, y)) / 255);
+    }
+}
+
+void Dither::apply(Mode mode, Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target, int levels)
+{
+    if (mode == MODE_DIFFUSION)
+    {
+        diffuse(source, target, levels);
+        return;
+    }
+
+    unsigned char greys[256];
+    levelGreys(levels, greys);
+    const int width = source.width();
+    ThreadPool::shared().parallelFor(source.height(), ThreadPool::grainFor(width), [&](int first, int last)
+    {
+        for (int y = first; y < last; ++y)
+        {
+            // the levels are mapped to their grey values in place
+            orderedRow(source.row(y), target.row(y), width, y, levels);
+            ByteTable::mapRow(greys, target.row(y), target.row(y), width);
+        }
+    });
+}
@@ -0,0 +1,57 @@
+#ifndef DITHER_H
+#define DITHER_H
+
+#include "buffer2d.hpp"
+
+/**
+ * @class Dither
+ * @brief Quantization of a grey plane to the levels of the glyphs, with dithering.
+ *
+ * The plane is reduced to a number of evenly spaced levels, one per glyph of the transition string
+ * or two for the dark and light pixels of half blocks and Braille dots. Every target pixel is the
+ * smallest grey value of its level, so mapping the target to glyphs gives the dithered glyph and
+ * comparing it with CellEncoding::THRESHOLD gives the dithered dot.
+ *
+ * Ordered dithering compares with an 8 x 8 Bayer matrix, every pixel on its own. Error diffusion
+ * (Floyd-Steinberg) carries the error of every pixel to its right and lower neighbours, so a row
+ * runs left to right behind the row above it: the rows are a wavefront on the thread pool and
+ * every row waits until the row above is two pixels ahead. The result does not depend on the
+ * number of threads.
+ */
+class Dither
+{
+public:
+    /**
+     * @enum Mode
+     * @brief The kind of dithering.
+     */
+    enum Mode
+    {
+        MODE_NONE,      /**< No dithering, every pixel takes the level it falls in. */
+        MODE_ORDERED,   /**< Ordered dithering with an 8 x 8 Bayer matrix. */
+        MODE_DIFFUSION  /**< Floyd-Steinberg error diffusion. */
+    };
+
+    /**
+     * @brief Dither a grey plane.
+     * @param mode The kind of dithering, not MODE_NONE.
+     * @param source The grey plane.
+     * @param target The dithered plane, as large as the source.
+     * @param levels The number of levels, 2 to 256.
+     */
+    static void apply(Mode mode, Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target, int levels);
+
+    /**
+     * @brief Compute the levels of a row with ordered dithering.
+     * @param grey The grey values.
+     * @param level The level of every grey value, 0 to levels - 1.
+     * @param count The number of grey values.
+     * @param y The row index, which selects the row of the Bayer matrix.
+     * @param levels The number of levels, 2 to 256.
+     *
+     * Level k is floor(grey * (levels - 1) / 255 + t) with the threshold t of the matrix cell in (0, 1).
+     */
+    static void orderedRow(const unsigned char *grey, unsigned char *level, int count, int y, int levels);
+};
+
+#endif
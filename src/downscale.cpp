@@ -0,0 +1,90 @@
+/**
+ * @file downscale.cpp
+ * @brief Implementation of the Downscale class.
+ */
+
+#include "downscale.hpp"
+#include "threadpool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void Downscale::accumulateRow(uint32_t *sums, const unsigned char *row, int count)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    // widen 16 bytes to four vectors of 32-bit lanes and add them to the sums
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= count; x += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+        __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        __m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+        __m128i *out = reinterpret_cast<__m128i *>(sums + x);
+        _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), _mm_unpacklo_epi16(low, zero)));
+        _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(low, zero)));
+        _mm_storeu_si128(out + 2, _mm_add_epi32(_mm_loadu_si128(out + 2), _mm_unpacklo_epi16(high, zero)));
+        _mm_storeu_si128(out + 3, _mm_add_epi32(_mm_loadu_si128(out + 3), _mm_unpackhi_epi16(high, zero)));
+    }
+#endif
+    for (; x < count; ++x)
+    {
+        sums[x] += row[x];
+    }
+}
+
+void Downscale::areaAverage(Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target, int channels)
+{
+    const int sourceWidth = source.width() / channels, sourceHeight = source.height();
+    const int width = target.width() / channels, height = target.height();
+    if (sourceWidth == 0 || width == 0 || sourceHeight == 0 || height == 0)
+        return;
+
+    // the source columns of target column x are [columns[x], columns[x + 1])
+    std::vector<int> columns(width + 1);
+    for (int x = 0; x <= width; ++x)
+    {
+        columns[x] = static_cast<int>(static_cast<int64_t>(x) * sourceWidth / width);
+    }
+
+    // every band of target rows sums its own source rows
+    const long long rowsPerTarget = (sourceHeight + height - 1) / height;
+    ThreadPool::shared().parallelFor(height, ThreadPool::grainFor(rowsPerTarget * sourceWidth * channels), [&](int first, int last)
+    {
+        std::vector<uint32_t> sums(static_cast<size_t>(sourceWidth) * channels);
+        for (int y = first; y < last; ++y)
+        {
+            int top = static_cast<int>(static_cast<int64_t>(y) * sourceHeight / height);
+            int bottom = std::max(top + 1, static_cast<int>(static_cast<int64_t>(y + 1) * sourceHeight / height));
+
+            std::fill(sums.begin(), sums.end(), 0);
+            for (int sourceY = top; sourceY < bottom; ++sourceY)
+            {
+                accumulateRow(sums.data(), source.row(sourceY), sourceWidth * channels);
+            }
+
+            unsigned char *out = target.row(y);
+            for (int x = 0; x < width; ++x)
+            {
+                int left = columns[x];
+                int right = std::max(left + 1, columns[x + 1]);
+                uint64_t area = static_cast<uint64_t>(right - left) * (bottom - top);
+
+                for (int channel = 0; channel < channels; ++channel)
+                {
+                    uint64_t sum = 0;
+                    for (int sourceX = left; sourceX < right; ++sourceX)
+                    {
+                        sum += sums[sourceX * channels + channel];
+                    }
+                    out[x * channels + channel] = static_cast<unsigned char>((sum + area / 2) / area);
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,38 @@
+#ifndef DOWNSCALE_H
+#define DOWNSCALE_H
+
+#include "buffer2d.hpp"
+#include <cstdint>
+
+/**
+ * @class Downscale
+ * @brief Area-averaging reduction of a grey plane or of interleaved color components.
+ *
+ * Every target pixel is the rounded mean of the block of source pixels it covers. The blocks
+ * tile the source exactly, so no source pixel is skipped and fine detail is averaged instead
+ * of aliased.
+ */
+class Downscale
+{
+public:
+    /**
+     * @brief Reduce a grey plane by area averaging.
+     * @param source The source plane.
+     * @param target The target plane, at most as wide and as high as the source.
+     * @param channels The number of interleaved components of a pixel, the widths are in bytes.
+     *
+     * Source rows are summed per column (a vectorized row-sum), then the column sums are
+     * reduced per target column, separately for every component.
+     */
+    static void areaAverage(Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target, int channels = 1);
+
+    /**
+     * @brief Add a row of bytes to a row of sums.
+     * @param sums The sums, one per byte.
+     * @param row The bytes.
+     * @param count The number of bytes.
+     */
+    static void accumulateRow(uint32_t *sums, const unsigned char *row, int count);
+};
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * @file edithistory.cpp
+ * @brief Implementation of the EditHistory class.
+ */
+
+#include "edithistory.hpp"
+#include <unordered_set>
+
+void EditHistory::clear()
+{
+    m_steps.clear();
+    m_current = 0;
+}
+
+size_t EditHistory::push(const FilterChain &filters, Buffer2DView<const unsigned char> filtered)
+{
+    if (!m_steps.empty())
+        m_steps.erase(m_steps.begin() + m_current + 1, m_steps.end());
+
+    Step step;
+    step.filters = filters;
+    size_t copied = 0;
+    if (!filtered.empty())
+    {
+        // share the tiles the filters did not change with the step the edit starts from
+        const TiledPlane *previous = m_steps.empty() || m_steps.back().filtered.empty() ? nullptr : &m_steps.back().filtered;
+        copied = step.filtered.capture(filtered, previous);
+    }
+
+    m_steps.push_back(step);
+    m_current = m_steps.size() - 1;
+    enforceLimit();
+    return copied;
+}
+
+const EditHistory::Step *EditHistory::current() const
+{
+    return m_steps.empty() ? nullptr : &m_steps[m_current];
+}
+
+const EditHistory::Step *EditHistory::undo()
+{
+    if (m_steps.empty() || m_current == 0)
+        return nullptr;
+    return &m_steps[--m_current];
+}
+
+const EditHistory::Step *EditHistory::redo()
+{
+    if (m_current + 1 >= m_steps.size())
+        return nullptr;
+    return &m_steps[++m_current];
+}
+
+void EditHistory::setLimit(size_t bytes)
+{
+    m_limit = bytes;
+    enforceLimit();
+}
+
+size_t EditHistory::memoryUsage() const
+{
+    std::unordered_set<const void *> seen;
+    size_t bytes = 0;
+    for (const Step &step : m_steps)
+    {
+        bytes += step.filtered.countNewTiles(seen);
+    }
+    return bytes;
+}
+
+void EditHistory::enforceLimit()
+{
+    while (memoryUsage() > m_limit)
+    {
+        // drop the tiles of the step farthest from the current one, the current one last
+        size_t farthest = m_steps.size();
+        size_t distance = 0;
+        for (size_t i = 0; i < m_steps.size(); ++i)
+        {
+            size_t d = i > m_current ? i - m_current : m_current - i;
+            if (!m_steps[i].filtered.empty() && (farthest == m_steps.size() || d > distance))
+            {
+                farthest = i;
+                distance = d;
+            }
+        }
+        if (farthest == m_steps.size())
+            return;
+        m_steps[farthest].filtered.clear();
+    }
+}
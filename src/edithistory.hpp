@@ -0,0 +1,94 @@
+#ifndef EDITHISTORY_H
+#define EDITHISTORY_H
+
+#include "filterchain.hpp"
+#include "tiledplane.hpp"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class EditHistory
+ * @brief The filter edits of an image, with undo and redo.
+ *
+ * Every step stores the filters and a TiledPlane of the filtered plane they gave, which shares
+ * the unchanged tiles with the step before it. Undo and redo copy the stored tiles back instead
+ * of applying the filters again. The tiles of all steps are kept under a memory limit: above it
+ * the tiles of the steps farthest from the current one are dropped, those steps then have to
+ * apply their filters again.
+ */
+class EditHistory
+{
+public:
+    /**
+     * @struct Step
+     * @brief One state of the image.
+     */
+    struct Step
+    {
+        FilterChain filters; /**< The filters of this state. */
+        TiledPlane filtered; /**< The filtered plane, empty without filters or when dropped. */
+    };
+
+    /** The default memory limit of the tiles in bytes. */
+    static constexpr size_t DEFAULT_LIMIT = 256 << 20;
+
+private:
+    std::vector<Step> m_steps;       /**< The steps, the oldest first. */
+    size_t m_current = 0;            /**< The index of the current step. */
+    size_t m_limit = DEFAULT_LIMIT; /**< The memory limit of the tiles. */
+
+    /**
+     * @brief Drop tiles until the memory use is within the limit.
+     */
+    void enforceLimit();
+
+public:
+    /**
+     * @brief Remove all steps.
+     */
+    void clear();
+
+    /**
+     * @brief Add a step after the current one, the steps which could be redone are removed.
+     * @param filters The filters of the new step.
+     * @param filtered The filtered plane, empty if the filters have no effect.
+     * @return The number of tiles copied for the step.
+     */
+    size_t push(const FilterChain &filters, Buffer2DView<const unsigned char> filtered);
+
+    /**
+     * @brief Get the current step.
+     * @return The current step, nullptr if there are no steps.
+     */
+    const Step *current() const;
+
+    /**
+     * @brief Go one step back.
+     * @return The new current step, nullptr if there is nothing to undo.
+     */
+    const Step *undo();
+
+    /**
+     * @brief Go one step forward.
+     * @return The new current step, nullptr if there is nothing to redo.
+     */
+    const Step *redo();
+
+    /**
+     * @brief Set the memory limit of the tiles.
+     * @param bytes The limit in bytes.
+     */
+    void setLimit(size_t bytes);
+
+    size_t limit() const { return m_limit; }
+    size_t size() const { return m_steps.size(); }
+    size_t position() const { return m_current; }
+
+    /**
+     * @brief Get the memory used by the tiles of all steps.
+     * @return The number of bytes, shared tiles are counted once.
+     */
+    size_t memoryUsage() const;
+};
+
+#endif
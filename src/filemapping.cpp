@@ -0,0 +1,81 @@
+/**
+ * @file filemapping.cpp
+ * @brief Implementation of the FileMapping class.
+ */
+
+#include "filemapping.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+
+FileMapping::~FileMapping()
+{
+    release();
+}
+
+void FileMapping::release()
+{
+    if (m_mapped)
+        munmap(const_cast<unsigned char *>(m_data), m_size);
+
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_buffer.clear();
+}
+
+bool FileMapping::open(const std::string &filename)
+{
+    release();
+
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    if (S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+        void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            // the loaders read the file front to back
+            madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const unsigned char *>(mapping);
+            m_size = info.st_size;
+            m_mapped = true;
+            close(fd);
+            return true;
+        }
+    }
+
+    // fall back to reading the whole file, e.g. from a pipe
+    unsigned char chunk[65536];
+    while (true)
+    {
+        ssize_t count = read(fd, chunk, sizeof(chunk));
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+        {
+            close(fd);
+            m_buffer.clear();
+            return false;
+        }
+        if (count == 0)
+            break;
+        m_buffer.insert(m_buffer.end(), chunk, chunk + count);
+    }
+    close(fd);
+
+    m_data = m_buffer.empty() ? nullptr : m_buffer.data();
+    m_size = m_buffer.size();
+    return true;
+}
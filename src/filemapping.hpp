@@ -0,0 +1,55 @@
+#ifndef FILEMAPPING_H
+#define FILEMAPPING_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @class FileMapping
+ * @brief Read-only access to the whole content of a file as one byte span.
+ *
+ * Regular files are memory-mapped, so no data is copied and repeated loads of the same
+ * file are served from the page cache. Files which cannot be mapped (pipes, character
+ * devices) are read into a buffer with read().
+ */
+class FileMapping
+{
+    const unsigned char *m_data = nullptr; /**< The first byte of the file. */
+    size_t m_size = 0;                     /**< The size of the file in bytes. */
+    bool m_mapped = false;                 /**< Whether m_data is a mapping which has to be unmapped. */
+    std::vector<unsigned char> m_buffer;   /**< The content of the file if it is not mapped. */
+
+    void release();
+
+public:
+    FileMapping() = default;
+    FileMapping(const FileMapping &) = delete;
+    FileMapping &operator=(const FileMapping &) = delete;
+
+    /**
+     * @brief Destructor, unmaps the file.
+     */
+    ~FileMapping();
+
+    /**
+     * @brief Open a file.
+     * @param filename The name of the file.
+     * @return True if the file is opened and its content is available, false otherwise.
+     */
+    bool open(const std::string &filename);
+
+    /**
+     * @brief Get the content of the file.
+     * @return The pointer to the first byte, nullptr for an empty file.
+     */
+    const unsigned char *data() const { return m_data; }
+
+    /**
+     * @brief Get the size of the file.
+     * @return The size in bytes.
+     */
+    size_t size() const { return m_size; }
+};
+
+#endif
@@ -0,0 +1,342 @@
+/**
+ * @file filterchain.cpp
+ * @brief Implementation of the FilterChain class.
+ */
+
+#include "filterchain.hpp"
+#include "bytetable.hpp"
+#include "threadpool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+#if defined(__SSE2__)
+    /**
+     * @brief Reverse the order of 16 bytes.
+     */
+    inline __m128i reverseBytes(__m128i v)
+    {
+        v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    }
+#endif
+
+    /**
+     * @brief Reverse a row in place.
+     * @param row The row.
+     * @param width The number of pixels.
+     */
+    void reverseRow(unsigned char *row, int width)
+    {
+        int left = 0, right = width;
+#if defined(__SSE2__)
+        // exchange 16 byte blocks from both ends
+        for (; right - left >= 32; left += 16, right -= 16)
+        {
+            __m128i *front = reinterpret_cast<__m128i *>(row + left);
+            __m128i *back = reinterpret_cast<__m128i *>(row + right - 16);
+            __m128i first = _mm_loadu_si128(front);
+            __m128i last = _mm_loadu_si128(back);
+            _mm_storeu_si128(front, reverseBytes(last));
+            _mm_storeu_si128(back, reverseBytes(first));
+        }
+#endif
+        std::reverse(row + left, row + right);
+    }
+
+    /**
+     * @brief Map a row through a table, optionally reversing it.
+     * @param table The new grey value of every grey value.
+     * @param mirror Whether the row is reversed.
+     * @param source The source row.
+     * @param target The target row, it can be the source row.
+     * @param width The number of pixels.
+     */
+    void transformRow(const unsigned char *table, bool mirror, const unsigned char *source, unsigned char *target, int width)
+    {
+        ByteTable::mapRow(table, source, target, width);
+        if (mirror)
+            reverseRow(target, width);
+    }
+
+    /**
+     * @brief Apply folded point and geometric filters to a plane.
+     * @param fold The filters.
+     * @param source The source plane.
+     * @param target The target plane, of the same size and not overlapping the source.
+     */
+    void applyFold(const FilterChain::Fold &fold, Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target)
+    {
+        const int height = std::min(source.height(), target.height());
+        const int width = std::min(source.width(), target.width());
+        ThreadPool::shared().parallelFor(height, ThreadPool::grainFor(width), [&](int first, int last)
+        {
+            for (int y = first; y < last; ++y)
+            {
+                const unsigned char *row = source.row(fold.flip ? height - 1 - y : y);
+                transformRow(fold.table, fold.mirror, row, target.row(y), width);
+            }
+        });
+    }
+}
+
+FilterChain::Fold::Fold()
+{
+    for (int i = 0; i < 256; ++i)
+        table[i] = static_cast<unsigned char>(i);
+}
+
+bool FilterChain::Fold::isIdentity() const
+{
+    if (mirror || flip)
+        return false;
+    for (int i = 0; i < 256; ++i)
+    {
+        if (table[i] != i)
+            return false;
+    }
+    return true;
+}
+
+bool FilterChain::Fold::operator==(const Fold &other) const
+{
+    return mirror == other.mirror && flip == other.flip && memcmp(table, other.table, sizeof(table)) == 0;
+}
+
+FilterChain::FilterChain()
+{
+    reset();
+}
+
+void FilterChain::reset()
+{
+    for (int i = 0; i < 256; ++i)
+        m_table[i] = static_cast<unsigned char>(i);
+    m_mirror = false;
+    m_flip = false;
+    m_spatial.clear();
+    m_tail = Fold();
+    m_tones.clear();
+    m_identity = true;
+}
+
+void FilterChain::updateIdentity()
+{
+    m_identity = !m_mirror && !m_flip && m_spatial.empty();
+    for (int i = 0; i < 256 && m_identity; ++i)
+        m_identity = m_table[i] == i;
+}
+
+bool FilterChain::operator==(const FilterChain &other) const
+{
+    return samePlane(other) && m_tones == other.m_tones;
+}
+
+bool FilterChain::samePlane(const FilterChain &other) const
+{
+    return m_mirror == other.m_mirror && m_flip == other.m_flip && m_spatial == other.m_spatial && m_tail == other.m_tail &&
+           memcmp(m_table, other.m_table, sizeof(m_table)) == 0;
+}
+
+void FilterChain::addPoint(const unsigned char *map)
+{
+    for (int i = 0; i < 256; ++i)
+    {
+        m_table[i] = map[m_table[i]];
+        m_tail.table[i] = map[m_tail.table[i]];
+    }
+    updateIdentity();
+}
+
+void FilterChain::negate()
+{
+    unsigned char map[256];
+    for (int i = 0; i < 256; ++i)
+        map[i] = static_cast<unsigned char>(255 - i);
+    addPoint(map);
+}
+
+void FilterChain::brightness(int delta)
+{
+    unsigned char map[256];
+    for (int i = 0; i < 256; ++i)
+        map[i] = static_cast<unsigned char>(std::min(std::max(i + delta, 0), 255));
+    addPoint(map);
+}
+
+void FilterChain::mirror()
+{
+    m_mirror = !m_mirror;
+    m_tail.mirror = !m_tail.mirror;
+    updateIdentity();
+}
+
+void FilterChain::flip()
+{
+    m_flip = !m_flip;
+    m_tail.flip = !m_tail.flip;
+    updateIdentity();
+}
+
+void FilterChain::addSpatial(Spatial spatial)
+{
+    // the filters added so far run before it
+    spatial.before = m_tail;
+    m_spatial.push_back(spatial);
+    m_tail = Fold();
+    updateIdentity();
+}
+
+void FilterChain::convolve(Convolution::Kind kind, int radius)
+{
+    Spatial spatial;
+    spatial.pass = Spatial::PASS_CONVOLUTION;
+    spatial.kind = kind;
+    spatial.radius = radius;
+    addSpatial(spatial);
+}
+
+void FilterChain::equalize(int clip)
+{
+    Spatial spatial;
+    spatial.pass = Spatial::PASS_EQUALIZE;
+    spatial.clip = clip;
+    addSpatial(spatial);
+}
+
+void FilterChain::autoLevels()
+{
+    m_tones.push_back({true, 0});
+}
+
+void FilterChain::gamma(double gamma)
+{
+    m_tones.push_back({false, gamma});
+}
+
+void FilterChain::toneTable(const uint32_t *counts, unsigned char table[256]) const
+{
+    for (int i = 0; i < 256; ++i)
+        table[i] = static_cast<unsigned char>(i);
+
+    for (const Tone &tone : m_tones)
+    {
+        // the histogram as the curves so far left it
+        uint32_t toned[256] = {};
+        for (int i = 0; i < 256; ++i)
+            toned[table[i]] += counts[i];
+
+        unsigned char map[256];
+        if (tone.levels)
+            Histogram::levelsMap(toned, map);
+        else
+            Histogram::gammaMap(tone.gamma, toned, map);
+        for (int i = 0; i < 256; ++i)
+            table[i] = map[table[i]];
+    }
+}
+
+void FilterChain::apply(Buffer2DView<unsigned char> plane) const
+{
+    if (m_identity || plane.empty())
+        return;
+
+    if (!m_spatial.empty())
+    {
+        Buffer2D<unsigned char> copy(plane.width(), plane.height());
+        for (int y = 0; y < plane.height(); ++y)
+            memcpy(copy.row(y), plane.row(y), plane.width());
+        apply(copy.view(), plane);
+        return;
+    }
+
+    const int width = plane.width(), height = plane.height();
+    if (!m_flip)
+    {
+        for (int y = 0; y < height; ++y)
+            transformRow(m_table, m_mirror, plane.row(y), plane.row(y), width);
+        return;
+    }
+
+    // a flip exchanges pairs of rows
+    std::vector<unsigned char> scratch(width);
+    for (int y = 0; y < (height + 1) / 2; ++y)
+    {
+        unsigned char *top = plane.row(y);
+        unsigned char *bottom = plane.row(height - 1 - y);
+        memcpy(scratch.data(), top, width);
+        transformRow(m_table, m_mirror, bottom, top, width);
+        if (bottom != top)
+            transformRow(m_table, m_mirror, scratch.data(), bottom, width);
+    }
+}
+
+void FilterChain::apply(Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target, const Histogram *histogram) const
+{
+    const int height = std::min(source.height(), target.height());
+    const int width = std::min(source.width(), target.width());
+
+    if (m_spatial.empty())
+    {
+        applyFold(m_tail, source, target);
+        return;
+    }
+
+    // the passes in order, a spatial filter or the filters folded before it or after the last one
+    struct Step
+    {
+        const Fold *fold;
+        const Spatial *spatial;
+    };
+    std::vector<Step> steps;
+    for (const Spatial &spatial : m_spatial)
+    {
+        if (!spatial.before.isIdentity())
+            steps.push_back({&spatial.before, nullptr});
+        steps.push_back({nullptr, &spatial});
+    }
+    if (!m_tail.isIdentity())
+        steps.push_back({&m_tail, nullptr});
+
+    // counted from the last pass, the passes write the target, the scratch plane, the target, ...
+    Buffer2D<unsigned char> scratch;
+    if (steps.size() > 1)
+        scratch.resize(width, height);
+    Buffer2DView<const unsigned char> input = source.view(0, 0, width, height);
+    for (size_t i = 0; i < steps.size(); ++i)
+    {
+        Buffer2DView<unsigned char> output = (steps.size() - 1 - i) % 2 ? scratch.view() : target.view(0, 0, width, height);
+        const Spatial *spatial = steps[i].spatial;
+        if (!spatial)
+        {
+            applyFold(*steps[i].fold, input, output);
+        }
+        else if (spatial->pass == Spatial::PASS_EQUALIZE)
+        {
+            // only the histogram of the source is known, an equalization after other filters counts its input
+            if (i == 0 && histogram && histogram->covers(width, height))
+            {
+                Histogram::equalize(spatial->clip, *histogram, input, output);
+            }
+            else
+            {
+                std::unique_ptr<Histogram> counted = std::make_unique<Histogram>();
+                counted->compute(input);
+                Histogram::equalize(spatial->clip, *counted, input, output);
+            }
+        }
+        else
+        {
+            Convolution::apply(spatial->kind, spatial->radius, input, output);
+        }
+        input = output;
+    }
+}
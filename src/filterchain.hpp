@@ -0,0 +1,240 @@
+#ifndef FILTERCHAIN_H
+#define FILTERCHAIN_H
+
+#include "buffer2d.hpp"
+#include "convolution.hpp"
+#include "histogram.hpp"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class FilterChain
+ * @brief A sequence of filters folded into one pass over a grey plane.
+ *
+ * Point filters (negate, brightness, ...) change every grey value on its own, so any number
+ * of them compose into one 256-entry table. Geometric filters (mirror, flip) only move
+ * pixels and commute with point filters, so they compose into one index remap.
+ * Applying the chain reads and writes every pixel once, whatever the number of filters.
+ *
+ * Spatial filters (blur, sharpen, edges, local equalization) depend on the neighbours of a pixel
+ * and do not fold. Every spatial filter keeps the point and geometric filters added since the
+ * spatial filter before it, so the chain is a sequence of folded passes and spatial passes in
+ * the order the filters were added. A folded pass which changes nothing is skipped.
+ *
+ * Tone curves (auto levels, gamma) depend on the histogram of the filtered plane, so they come
+ * last and are not applied to the plane: toneTable builds them from the histogram and the image
+ * merges the resulting table into the glyph mapping of the cells.
+ */
+class FilterChain
+{
+public:
+    /**
+     * @struct Fold
+     * @brief Point and geometric filters folded into one pass.
+     */
+    struct Fold
+    {
+        unsigned char table[256]; /**< The composition of the point filters. */
+        bool mirror = false;      /**< Whether the rows are reversed. */
+        bool flip = false;        /**< Whether the order of the rows is reversed. */
+
+        /**
+         * @brief Create a fold which changes nothing.
+         */
+        Fold();
+
+        /**
+         * @brief Check whether the fold changes nothing.
+         * @return True if the table is the identity and nothing is mirrored or flipped.
+         */
+        bool isIdentity() const;
+
+        bool operator==(const Fold &other) const;
+    };
+
+    /**
+     * @struct Spatial
+     * @brief One spatial filter.
+     */
+    struct Spatial
+    {
+        /**
+         * @enum Pass
+         * @brief The kind of pass of a spatial filter.
+         */
+        enum Pass
+        {
+            PASS_CONVOLUTION, /**< A Convolution::apply pass, of kind and radius. */
+            PASS_EQUALIZE     /**< A Histogram::equalize pass, of clip. */
+        };
+
+        Fold before;                                         /**< The filters added since the spatial filter before. */
+        Pass pass = PASS_CONVOLUTION;                        /**< The kind of pass. */
+        Convolution::Kind kind = Convolution::KIND_BOX_BLUR; /**< The convolution of a convolution pass. */
+        int radius = 0;                                      /**< The radius in pixels of a convolution pass. */
+        int clip = 0;                                        /**< The clip limit of an equalization pass. */
+
+        bool operator==(const Spatial &other) const
+        {
+            return before == other.before && pass == other.pass && (pass == PASS_EQUALIZE ? clip == other.clip : kind == other.kind && radius == other.radius);
+        }
+    };
+
+    /**
+     * @struct Tone
+     * @brief One tone curve.
+     */
+    struct Tone
+    {
+        bool levels;  /**< True to stretch the levels, false for a gamma curve. */
+        double gamma; /**< The gamma of a gamma curve, 0 to pick it from the histogram. */
+
+        bool operator==(const Tone &other) const { return levels == other.levels && gamma == other.gamma; }
+    };
+
+private:
+    unsigned char m_table[256]; /**< The composition of all point filters. */
+    bool m_mirror = false;      /**< Whether the rows are reversed. */
+    bool m_flip = false;        /**< Whether the order of the rows is reversed. */
+    bool m_identity = true;     /**< Whether applying the chain changes nothing. */
+    std::vector<Spatial> m_spatial; /**< The spatial filters, each after the filters added before it. */
+    Fold m_tail;                    /**< The filters added after the last spatial filter. */
+    std::vector<Tone> m_tones;      /**< The tone curves, applied after the others. */
+
+    /**
+     * @brief Recompute m_identity after a change.
+     */
+    void updateIdentity();
+
+    /**
+     * @brief Append a spatial filter after the filters added so far.
+     * @param spatial The filter, its before is set here.
+     */
+    void addSpatial(Spatial spatial);
+
+public:
+    /**
+     * @brief Create an empty chain.
+     */
+    FilterChain();
+
+    /**
+     * @brief Remove all filters.
+     */
+    void reset();
+
+    /**
+     * @brief Check whether applying the chain to a plane has no effect.
+     * @return True if apply changes nothing, the chain can still have tone curves.
+     */
+    bool isIdentity() const { return m_identity; }
+
+    /**
+     * @brief Check whether two chains have the same effect.
+     * @param other The other chain.
+     * @return True if both chains give the same result on every plane.
+     */
+    bool operator==(const FilterChain &other) const;
+    bool operator!=(const FilterChain &other) const { return !(*this == other); }
+
+    /**
+     * @brief Check whether two chains give the same plane.
+     * @param other The other chain.
+     * @return True if the chains differ at most in their tone curves.
+     */
+    bool samePlane(const FilterChain &other) const;
+
+    /**
+     * @brief Append a point filter.
+     * @param map The new grey value of every grey value.
+     */
+    void addPoint(const unsigned char *map);
+
+    /**
+     * @brief Append the negation of the grey values.
+     */
+    void negate();
+
+    /**
+     * @brief Append a change of brightness, the results are clamped to [0, 255].
+     * @param delta The amount added to every grey value.
+     */
+    void brightness(int delta);
+
+    /**
+     * @brief Append a horizontal mirror.
+     */
+    void mirror();
+
+    /**
+     * @brief Append a vertical flip.
+     */
+    void flip();
+
+    /**
+     * @brief Append a spatial filter.
+     * @param kind The filter.
+     * @param radius Its radius in pixels, see Convolution::apply.
+     */
+    void convolve(Convolution::Kind kind, int radius);
+
+    /**
+     * @brief Append a local histogram equalization.
+     * @param clip The clip limit, see Histogram::equalize.
+     */
+    void equalize(int clip);
+
+    /**
+     * @brief Append the stretch of the levels of the filtered plane to the full range.
+     */
+    void autoLevels();
+
+    /**
+     * @brief Append a gamma curve.
+     * @param gamma The gamma, see Histogram::gammaMap.
+     */
+    void gamma(double gamma);
+
+    bool hasTones() const { return !m_tones.empty(); }
+    bool hasSpatial() const { return !m_spatial.empty(); }
+
+    /**
+     * @brief Build the composed tone curves.
+     * @param counts The histogram of the filtered plane.
+     * @param table The new grey value of every filtered grey value.
+     *
+     * Every curve is built from the histogram as the curves before it left it.
+     */
+    void toneTable(const uint32_t *counts, unsigned char table[256]) const;
+
+    /**
+     * @brief Get the composition of all point filters, without the spatial filters between them.
+     * @return The new grey value of every grey value.
+     */
+    const unsigned char *table() const { return m_table; }
+
+    bool isMirrored() const { return m_mirror; }
+    bool isFlipped() const { return m_flip; }
+
+    /**
+     * @brief Apply the chain to a plane in place.
+     * @param plane The plane.
+     *
+     * With spatial filters the plane is copied first.
+     */
+    void apply(Buffer2DView<unsigned char> plane) const;
+
+    /**
+     * @brief Apply the chain to a plane.
+     * @param source The source plane.
+     * @param target The target plane, of the same size and not overlapping the source.
+     * @param histogram The histogram of the source, used when a local equalization is the first
+     *                  pass, nullptr to count it in a pass of its own.
+     *
+     * The passes alternate between the target and one scratch plane, so that the last one
+     * writes the target.
+     */
+    void apply(Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target, const Histogram *histogram = nullptr) const;
+};
+
+#endif
@@ -0,0 +1,36 @@
+/**
+ * @file framering.cpp
+ * @brief Implementation of the FrameRing class.
+ */
+
+#include "framering.hpp"
+#include <algorithm>
+
+FrameRing::FrameRing(size_t capacity) : m_slots(std::max<size_t>(capacity, 1)) {}
+
+FrameRing::Frame *FrameRing::reserve()
+{
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    // the consumer has to release the slot before it is written again
+    if (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+        return nullptr;
+    return &m_slots[tail % m_slots.size()];
+}
+
+void FrameRing::push()
+{
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+const FrameRing::Frame *FrameRing::front() const
+{
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire))
+        return nullptr;
+    return &m_slots[head % m_slots.size()];
+}
+
+void FrameRing::pop()
+{
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
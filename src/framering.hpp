@@ -0,0 +1,74 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @class FrameRing
+ * @brief A bounded ring of rendered frames between one producer and one consumer thread.
+ *
+ * The producer writes a frame into a free slot and publishes it, the consumer reads the oldest
+ * published frame and releases its slot. Neither side takes a lock: each index is written by one
+ * thread only and read by the other with acquire/release ordering. The slots keep their capacity,
+ * so after the first round no frame allocates.
+ */
+class FrameRing
+{
+public:
+    /**
+     * @struct Frame
+     * @brief The bytes of a rendered frame.
+     */
+    struct Frame
+    {
+        std::string update;  /**< The bytes changing the screen from the frame before. */
+        std::string full;    /**< The bytes repainting the whole screen. */
+        bool repaint = true; /**< Whether the frame has to be repainted, update is then empty. */
+    };
+
+private:
+    std::vector<Frame> m_slots;       /**< The frames, used round robin. */
+    std::atomic<size_t> m_head{0};    /**< The number of frames consumed, written by the consumer. */
+    std::atomic<size_t> m_tail{0};    /**< The number of frames published, written by the producer. */
+
+public:
+    /**
+     * @brief Constructor of the FrameRing class.
+     * @param capacity The most frames ready at once, at least 1.
+     */
+    explicit FrameRing(size_t capacity);
+
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    /**
+     * @brief Get a free slot, called by the producer.
+     * @return The slot to render the next frame into, nullptr if the ring is full.
+     *
+     * The slot is not seen by the consumer until push is called.
+     */
+    Frame *reserve();
+
+    /**
+     * @brief Publish the slot returned by reserve, called by the producer.
+     */
+    void push();
+
+    /**
+     * @brief Get the oldest frame, called by the consumer.
+     * @return The frame, nullptr if the ring is empty.
+     */
+    const Frame *front() const;
+
+    /**
+     * @brief Release the frame returned by front, called by the consumer.
+     */
+    void pop();
+
+    size_t capacity() const { return m_slots.size(); }
+};
+
+#endif
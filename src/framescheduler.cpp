@@ -0,0 +1,90 @@
+/**
+ * @file framescheduler.cpp
+ * @brief Implementation of the FrameScheduler class.
+ */
+
+#include "framescheduler.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+
+namespace
+{
+    const long long NANOSECONDS = 1000000000LL;
+}
+
+FrameScheduler::FrameScheduler(double period) : m_period(std::llround(std::max(period, 0.0) * NANOSECONDS)) {}
+
+long long FrameScheduler::elapsed() const
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - m_start.tv_sec) * NANOSECONDS + (now.tv_nsec - m_start.tv_nsec);
+}
+
+void FrameScheduler::sleepUntil(long long time) const
+{
+    const long long nanoseconds = m_start.tv_nsec + time;
+    timespec deadline;
+    deadline.tv_sec = m_start.tv_sec + nanoseconds / NANOSECONDS;
+    deadline.tv_nsec = nanoseconds % NANOSECONDS;
+    // a signal, e.g. a terminal resize, interrupts the sleep but not the deadline
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+    {
+    }
+}
+
+void FrameScheduler::start()
+{
+    clock_gettime(CLOCK_MONOTONIC, &m_start);
+    m_late.clear();
+    m_dropped = 0;
+    m_last_shown = 0;
+}
+
+bool FrameScheduler::waitFor(long long frame)
+{
+    const long long deadline = frame * m_period;
+    long long now = elapsed();
+    // past the deadline of the next frame, showing this one would only delay the others
+    if (m_period > 0 && now >= deadline + m_period)
+    {
+        ++m_dropped;
+        return false;
+    }
+
+    if (now < deadline)
+    {
+        sleepUntil(deadline);
+        now = elapsed();
+    }
+    // without a period every frame is due at once, lateness has no meaning
+    m_late.push_back(m_period > 0 ? std::max(0LL, now - deadline) : 0);
+    m_last_shown = now;
+    return true;
+}
+
+void FrameScheduler::finish(long long frames)
+{
+    if (elapsed() < frames * m_period)
+        sleepUntil(frames * m_period);
+}
+
+double FrameScheduler::achievedRate() const
+{
+    const long long first = m_late.empty() ? 0 : m_late.front();
+    if (m_late.size() < 2 || m_last_shown <= first)
+        return 0;
+    // the first shown frame is frame 0, dropping happens only later
+    return static_cast<double>(m_late.size() - 1) * NANOSECONDS / (m_last_shown - first);
+}
+
+double FrameScheduler::lateness(double percentile) const
+{
+    if (m_late.empty())
+        return 0;
+    std::vector<long long> sorted(m_late);
+    const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(std::max(percentile, 0.0) / 100 * sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return static_cast<double>(sorted[index]) / NANOSECONDS;
+}
@@ -0,0 +1,78 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <ctime>
+#include <vector>
+
+/**
+ * @class FrameScheduler
+ * @brief Paces frames to absolute deadlines on the monotonic clock.
+ *
+ * Frame k is due at start + k * period. Waiting for a deadline sleeps with clock_nanosleep and
+ * TIMER_ABSTIME, so time spent rendering and writing a frame does not add to the period and
+ * errors do not accumulate over long runs. A frame which is already past the deadline of the
+ * next one is dropped to catch up. The lateness of every shown frame is kept for statistics.
+ */
+class FrameScheduler
+{
+    long long m_period;              /**< The frame period in nanoseconds. */
+    timespec m_start{};              /**< The deadline of frame 0. */
+    std::vector<long long> m_late;   /**< How late every shown frame started, in nanoseconds. */
+    long long m_dropped = 0;         /**< The number of dropped frames. */
+    long long m_last_shown = 0;      /**< The time of the last shown frame since the start, in nanoseconds. */
+
+    /**
+     * @brief Get the time since the start.
+     * @return The time in nanoseconds.
+     */
+    long long elapsed() const;
+
+    /**
+     * @brief Sleep until a time since the start.
+     * @param time The time in nanoseconds.
+     */
+    void sleepUntil(long long time) const;
+
+public:
+    /**
+     * @brief Constructor of the FrameScheduler class.
+     * @param period The frame period in seconds, 0 shows frames as fast as they come.
+     */
+    explicit FrameScheduler(double period);
+
+    /**
+     * @brief Make the current time the deadline of frame 0 and clear the statistics.
+     */
+    void start();
+
+    /**
+     * @brief Wait for the deadline of a frame.
+     * @param frame The index of the frame.
+     * @return True if the frame has to be shown now, false if it is dropped.
+     */
+    bool waitFor(long long frame);
+
+    /**
+     * @brief Wait for the end of the last frame period.
+     * @param frames The number of frames.
+     */
+    void finish(long long frames);
+
+    long long shownFrames() const { return static_cast<long long>(m_late.size()); }
+    long long droppedFrames() const { return m_dropped; }
+
+    /**
+     * @brief Get the frame rate reached from the first to the last shown frame.
+     * @return The frames per second, 0 with less than two shown frames.
+     */
+    double achievedRate() const;
+
+    /**
+     * @brief Get a percentile of how late the shown frames started.
+     * @param percentile The percentile from 0 to 100.
+     * @return The lateness in seconds.
+     */
+    double lateness(double percentile) const;
+};
+
+#endif
@@ -0,0 +1,134 @@
+/**
+ * @file glyphshapes.cpp
+ * @brief Implementation of the GlyphShapes class.
+ */
+
+#include "glyphshapes.hpp"
+#include <algorithm>
+
+namespace
+{
+    // the 4 x 8 bitmaps of ' ' to '~', bit row * 4 + column, rendered from DejaVu Sans Mono with a
+    // pixel set where the glyph covers at least a fifth of it
+    const uint32_t GLYPH_BITMAPS[95] = {
+        0x00000000, 0x00066600, 0x00000660, 0x007FFE80, 0x06FE7640, 0x04CFF320, 0x0AFD2260, 0x00000600,  //  !"#$%&'
+        0x04222640, 0x02444620, 0x00006600, 0x006F6000, 0x06600000, 0x00060000, 0x00600000, 0x01224400,  // ()*+,-./
+        0x06F9FF60, 0x06644460, 0x06364C70, 0x06DC6C70, 0x044F6640, 0x02DC7360, 0x06F9F360, 0x02244CF0,  // 01234567
+        0x06FF6F60, 0x026EDD60, 0x00606000, 0x06606000, 0x00C3E000, 0x000FF000, 0x003C7000, 0x00264C60,  // 89:;<=>?
+        0x43FBFF00, 0x099F6660, 0x06FBFF70, 0x04E113E0, 0x02F99D70, 0x0633F3E0, 0x0033F3E0, 0x04FD1360,  // @ABCDEFG
+        0x0099F990, 0x06666660, 0x02744460, 0x08D77590, 0x0E333300, 0x099FFF90, 0x00DDBB90, 0x06F99F60,  // HIJKLMNO
+        0x0037FB60, 0x06F99F60, 0x0897FD70, 0x06FC7160, 0x006666F0, 0x06F99990, 0x0066F990, 0x00FFF990,  // PQRSTUVW
+        0x09F66E90, 0x00666F90, 0x0E324CF0, 0x46222260, 0x0C462310, 0x26444460, 0x00000660, 0xF0000000,  // XYZ[\]^_
+        0x00000020, 0x02FFC600, 0x04FBF710, 0x04232600, 0x02FDFE80, 0x047FB600, 0x006666C0, 0x6EFDF600,  // `abcdefg
+        0x00BBF710, 0x06666240, 0x24446640, 0x08F77320, 0x04622230, 0x00FFFE00, 0x00BBF600, 0x06F9F600,  // hijklmno
+        0x17FBF600, 0x8EF9F600, 0x02222E00, 0x06E63600, 0x04622600, 0x02FBB000, 0x0066F900, 0x00FF9000,  // pqrstuvw
+        0x09666000, 0x3666B800, 0x06264600, 0x46626640, 0x66666600, 0x26646620, 0x000F0000,              // xyz{|}~
+    };
+
+    int matchScalar(const uint32_t *masks, int count, uint32_t mask)
+    {
+        int best = 0, distance = 33;
+        for (int i = 0; i < count; ++i)
+        {
+            const int d = __builtin_popcount(masks[i] ^ mask);
+            if (d < distance)
+            {
+                best = i;
+                distance = d;
+            }
+        }
+        return best;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    /**
+     * @brief The same search with the popcnt instruction instead of the bit counting sequence.
+     */
+    __attribute__((target("popcnt"))) int matchPopcnt(const uint32_t *masks, int count, uint32_t mask)
+    {
+        int best = 0, distance = 33;
+        for (int i = 0; i < count; ++i)
+        {
+            const int d = __builtin_popcount(masks[i] ^ mask);
+            if (d < distance)
+            {
+                best = i;
+                distance = d;
+            }
+        }
+        return best;
+    }
+#endif
+
+    typedef int (*MatchKernel)(const uint32_t *, int, uint32_t);
+
+    MatchKernel matchKernel()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        static const MatchKernel selected = (__builtin_cpu_init(), __builtin_cpu_supports("popcnt") ? matchPopcnt : matchScalar);
+        return selected;
+#else
+        return matchScalar;
+#endif
+    }
+}
+
+GlyphShapes::GlyphShapes(const std::string &transition) : m_masks(), m_candidates()
+{
+    for (char glyph : transition)
+    {
+        const unsigned char value = static_cast<unsigned char>(glyph);
+        if (value < ' ' || value > '~' || std::find(m_candidates, m_candidates + m_count, glyph) != m_candidates + m_count)
+            continue;
+        m_masks[m_count] = GLYPH_BITMAPS[value - ' '];
+        m_candidates[m_count++] = glyph;
+    }
+}
+
+char GlyphShapes::match(uint32_t mask) const
+{
+    return m_count ? m_candidates[matchKernel()(m_masks, m_count, mask)] : ' ';
+}
+
+void GlyphShapes::matchRow(const unsigned char *const rows[ROWS], const GlyphTable &glyphs, char *cells, int count, Cache &cache) const
+{
+    for (int x = 0; x < count; ++x)
+    {
+        unsigned sum = 0, darkest = 255, lightest = 0;
+        for (int row = 0; row < ROWS; ++row)
+        {
+            const unsigned char *grey = rows[row] + COLUMNS * x;
+            for (int column = 0; column < COLUMNS; ++column)
+            {
+                sum += grey[column];
+                darkest = std::min<unsigned>(darkest, grey[column]);
+                lightest = std::max<unsigned>(lightest, grey[column]);
+            }
+        }
+        if (lightest - darkest < MIN_CONTRAST)
+        {
+            cells[x] = glyphs[static_cast<unsigned char>(sum / (COLUMNS * ROWS))];
+            continue;
+        }
+
+        // a pixel is dark when it is below the average, compared as grey * 32 < sum
+        uint32_t mask = 0;
+        for (int row = 0; row < ROWS; ++row)
+        {
+            const unsigned char *grey = rows[row] + COLUMNS * x;
+            for (int column = 0; column < COLUMNS; ++column)
+            {
+                mask |= static_cast<uint32_t>(grey[column] * (COLUMNS * ROWS) < sum) << (row * COLUMNS + column);
+            }
+        }
+
+        // Fibonacci hashing spreads the masks over the entries
+        const unsigned slot = (mask * 2654435769u) >> 22 & (Cache::SIZE - 1);
+        if (cache.masks[slot] != mask)
+        {
+            cache.masks[slot] = mask;
+            cache.glyphs[slot] = match(mask);
+        }
+        cells[x] = cache.glyphs[slot];
+    }
+}
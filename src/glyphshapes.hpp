@@ -0,0 +1,81 @@
+#ifndef GLYPHSHAPES_H
+#define GLYPHSHAPES_H
+
+#include "glyphtable.hpp"
+#include <cstdint>
+#include <string>
+
+/**
+ * @class GlyphShapes
+ * @brief The bitmaps of the glyphs of one transition string, for picking glyphs by shape.
+ *
+ * A cell covers COLUMNS x ROWS pixels. Its pixels darker than the cell average form a 32-bit
+ * mask, bit row * COLUMNS + column, and the glyph whose bitmap differs from the mask in the
+ * fewest pixels is taken (XOR and popcount per glyph). Cells with less contrast than
+ * MIN_CONTRAST have no shape to match and take the glyph of their average brightness.
+ *
+ * The bitmaps are precomputed for the printable ASCII characters, other glyphs of the
+ * transition string are never matched by shape. A match costs one popcount per glyph, at most
+ * 95, and the matches of recent masks are kept in a Cache, so repeated patterns cost a lookup.
+ */
+class GlyphShapes
+{
+public:
+    /** The pixel columns of a cell. */
+    static constexpr int COLUMNS = 4;
+
+    /** The pixel rows of a cell. */
+    static constexpr int ROWS = 8;
+
+    /** The least difference between the darkest and the lightest pixel of a cell matched by shape. */
+    static constexpr int MIN_CONTRAST = 48;
+
+    /**
+     * @struct Cache
+     * @brief The glyphs of recently matched masks, one per worker, direct mapped.
+     *
+     * A matched mask is never 0, so 0 marks an empty entry.
+     */
+    struct Cache
+    {
+        static constexpr int SIZE = 1024; /**< The number of entries, a power of two. */
+        uint32_t masks[SIZE] = {};        /**< The mask of every entry. */
+        char glyphs[SIZE] = {};           /**< The glyph matched for the mask. */
+    };
+
+private:
+    uint32_t m_masks[95]; /**< The bitmaps of the glyphs which can be matched. */
+    char m_candidates[95]; /**< The glyphs which can be matched, from the darkest to the lightest. */
+    int m_count = 0;       /**< The number of glyphs which can be matched. */
+
+public:
+    /**
+     * @brief Collect the bitmaps of the glyphs of a transition string.
+     * @param transition The glyphs from the darkest to the lightest.
+     */
+    explicit GlyphShapes(const std::string &transition);
+
+    /**
+     * @brief Collect the bitmaps of the glyphs of the default transition string.
+     */
+    GlyphShapes() : GlyphShapes(GlyphTable::DEFAULT_TRANSITION) {}
+
+    /**
+     * @brief Find the glyph closest to a mask.
+     * @param mask The dark pixels of a cell.
+     * @return The glyph with the least Hamming distance, the darkest one on a tie, a space without glyphs.
+     */
+    char match(uint32_t mask) const;
+
+    /**
+     * @brief Pick the glyphs of a row of cells.
+     * @param rows The ROWS pixel rows of the cells, each with COLUMNS * count grey values.
+     * @param glyphs The glyph of every grey value, for the cells without contrast.
+     * @param cells The glyphs.
+     * @param count The number of cells.
+     * @param cache The matches of recent masks, used by one thread at a time.
+     */
+    void matchRow(const unsigned char *const rows[ROWS], const GlyphTable &glyphs, char *cells, int count, Cache &cache) const;
+};
+
+#endif
@@ -0,0 +1,24 @@
+/**
+ * @file glyphtable.cpp
+ * @brief Implementation of the GlyphTable row mapping.
+ */
+
+#include "glyphtable.hpp"
+#include "bytetable.hpp"
+
+namespace
+{
+    // the table of the default transition string is built by the compiler
+    constexpr GlyphTable DEFAULT_TABLE;
+    static_assert(DEFAULT_TABLE[0] == '$' && DEFAULT_TABLE[255] == ' ', "the default glyph table is built at compile time");
+}
+
+const GlyphTable &GlyphTable::defaultTable()
+{
+    return DEFAULT_TABLE;
+}
+
+void GlyphTable::mapRow(const unsigned char *grey, char *ascii, size_t count) const
+{
+    ByteTable::mapRow(reinterpret_cast<const unsigned char *>(m_glyphs), grey, reinterpret_cast<unsigned char *>(ascii), count);
+}
@@ -0,0 +1,78 @@
+#ifndef GLYPHTABLE_H
+#define GLYPHTABLE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @class GlyphTable
+ * @brief The glyph of every grey value for one transition string.
+ *
+ * Grey value g maps to the character at index g * (length - 1) / 255 of the transition
+ * string. The division is done once per grey value when the table is built, mapping a
+ * row is a pure table lookup (a multi-shuffle with SSSE3 or AVX2 where supported).
+ */
+class GlyphTable
+{
+    char m_glyphs[256]; /**< The glyph of every grey value. */
+
+public:
+    /** The transition string images start with, from the darkest to the lightest glyph. */
+    static constexpr char DEFAULT_TRANSITION[] = "$@B%8&WM#*oahkbdpqwmZO0QLCJUYXzcvunxrjft/\\|()1{}[]?-_+~<>i!lI;:,\"^`'. ";
+
+    /**
+     * @brief Build the table of a transition string.
+     * @param transition The glyphs from the darkest to the lightest.
+     * @param length The number of glyphs. With no glyphs every grey value maps to a space.
+     */
+    constexpr GlyphTable(const char *transition, size_t length) : m_glyphs()
+    {
+        for (int grey = 0; grey < 256; ++grey)
+            m_glyphs[grey] = length ? transition[grey * (length - 1) / 255] : ' ';
+    }
+
+    /**
+     * @brief Build the table of the default transition string.
+     */
+    constexpr GlyphTable() : GlyphTable(DEFAULT_TRANSITION, sizeof(DEFAULT_TRANSITION) - 1) {}
+
+    /**
+     * @brief Build the table of a transition string.
+     * @param transition The glyphs from the darkest to the lightest.
+     */
+    explicit GlyphTable(const std::string &transition) : GlyphTable(transition.data(), transition.size()) {}
+
+    /**
+     * @brief Build the table which maps every grey value through a point filter first.
+     * @param glyphs The table of the transition string.
+     * @param map The new grey value of every grey value.
+     */
+    GlyphTable(const GlyphTable &glyphs, const unsigned char *map) : m_glyphs()
+    {
+        for (int grey = 0; grey < 256; ++grey)
+            m_glyphs[grey] = glyphs.m_glyphs[map[grey]];
+    }
+
+    /**
+     * @brief Get the table of the default transition string.
+     * @return The table, built at compile time.
+     */
+    static const GlyphTable &defaultTable();
+
+    /**
+     * @brief Get the glyph of one grey value.
+     * @param grey The grey value.
+     * @return The glyph.
+     */
+    constexpr char operator[](unsigned char grey) const { return m_glyphs[grey]; }
+
+    /**
+     * @brief Map a row of grey values to glyphs.
+     * @param grey The grey values.
+     * @param ascii The output buffer, one glyph per grey value.
+     * @param count The number of grey values.
+     */
+    void mapRow(const unsigned char *grey, char *ascii, size_t count) const;
+};
+
+#endif
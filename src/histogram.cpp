@@ -0,0 +1,269 @@
+/**
+ * @file histogram.cpp
+ * @brief Implementation of the Histogram class.
+ */
+
+#include "histogram.hpp"
+#include "threadpool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    /**
+     * @brief Count a row into the banks, every bank takes every BANKS-th byte.
+     */
+    void countRow(const unsigned char *grey, int count, uint32_t (*banks)[256])
+    {
+        static_assert(Histogram::BANKS == 4, "the unrolled loop counts into 4 banks");
+        int x = 0;
+        for (; x + 8 <= count; x += 8)
+        {
+            uint64_t bytes;
+            memcpy(&bytes, grey + x, sizeof(bytes));
+            ++banks[0][bytes & 0xFF];
+            ++banks[1][bytes >> 8 & 0xFF];
+            ++banks[2][bytes >> 16 & 0xFF];
+            ++banks[3][bytes >> 24 & 0xFF];
+            ++banks[0][bytes >> 32 & 0xFF];
+            ++banks[1][bytes >> 40 & 0xFF];
+            ++banks[2][bytes >> 48 & 0xFF];
+            ++banks[3][bytes >> 56];
+        }
+        for (; x < count; ++x)
+            ++banks[x & 3][grey[x]];
+    }
+
+    /**
+     * @brief Get the first pixel of a tile, a pixel at p belongs to tile p * TILES / size.
+     */
+    int tileStart(int tile, int size)
+    {
+        return static_cast<int>((static_cast<long long>(tile) * size + Histogram::TILES - 1) / Histogram::TILES);
+    }
+
+    /**
+     * @brief Find the two tiles a pixel is interpolated between.
+     * @param position The pixel index.
+     * @param size The width or height of the plane.
+     * @param first The tile whose center is at or before the pixel.
+     * @param weight The weight of the tile after it, in 1/256.
+     *
+     * Before the first and after the last center the pixel takes the nearest tile alone.
+     */
+    void interpolation(int position, int size, int &first, int &weight)
+    {
+        const double tile = (position + 0.5) * Histogram::TILES / size - 0.5;
+        first = static_cast<int>(std::floor(tile));
+        weight = static_cast<int>(std::lround((tile - first) * 256));
+        if (first < 0 || first >= Histogram::TILES - 1)
+        {
+            first = std::min(std::max(first, 0), Histogram::TILES - 1);
+            weight = 0;
+        }
+    }
+
+    /**
+     * @brief Build the equalization map of one tile.
+     * @param counts The histogram of the tile.
+     * @param clip The clip limit in mean bins.
+     * @param map The new grey value of every grey value.
+     *
+     * The bins above the limit are cut and the excess is spread evenly over all bins, which bounds
+     * the slope of the map. Every grey value maps to the middle of its share of the cumulative histogram.
+     */
+    void tileMap(const uint32_t *counts, int clip, unsigned char map[256])
+    {
+        uint64_t area = 0;
+        for (int v = 0; v < 256; ++v)
+            area += counts[v];
+        if (!area)
+        {
+            for (int v = 0; v < 256; ++v)
+                map[v] = static_cast<unsigned char>(v);
+            return;
+        }
+
+        const uint64_t limit = std::max<uint64_t>(1, clip * area / 256);
+        uint64_t clipped[256], excess = 0;
+        for (int v = 0; v < 256; ++v)
+        {
+            clipped[v] = std::min<uint64_t>(counts[v], limit);
+            excess += counts[v] - clipped[v];
+        }
+        const uint64_t share = excess / 256, rest = excess % 256;
+        uint64_t below = 0;
+        for (int v = 0; v < 256; ++v)
+        {
+            clipped[v] += share + (v * rest / 256 != (v + 1) * rest / 256);
+            map[v] = static_cast<unsigned char>((255 * (2 * below + clipped[v]) + area) / (2 * area));
+            below += clipped[v];
+        }
+    }
+}
+
+Histogram::Histogram()
+{
+    reset(0, 0);
+}
+
+void Histogram::reset(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    m_total = 0;
+    memset(m_counts, 0, sizeof(m_counts));
+    memset(m_tiles, 0, sizeof(m_tiles));
+}
+
+void Histogram::addRows(Buffer2DView<const unsigned char> plane, int first, int last)
+{
+    int columns[TILES + 1];
+    for (int column = 0; column <= TILES; ++column)
+        columns[column] = tileStart(column, m_width);
+
+    // the banks of the tiles of one tile row, added to the shared counts when the band leaves it
+    uint32_t banks[TILES][BANKS][256];
+    int y = first;
+    while (y < last)
+    {
+        const int row = static_cast<int>(static_cast<long long>(y) * TILES / m_height);
+        const int end = std::min(last, tileStart(row + 1, m_height));
+        memset(banks, 0, sizeof(banks));
+        for (; y < end; ++y)
+        {
+            const unsigned char *grey = plane.row(y);
+            for (int column = 0; column < TILES; ++column)
+                countRow(grey + columns[column], columns[column + 1] - columns[column], banks[column]);
+        }
+        for (int column = 0; column < TILES; ++column)
+        {
+            for (int v = 0; v < 256; ++v)
+                banks[column][0][v] += banks[column][1][v] + banks[column][2][v] + banks[column][3][v];
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (int column = 0; column < TILES; ++column)
+        {
+            for (int v = 0; v < 256; ++v)
+            {
+                m_tiles[row][column][v] += banks[column][0][v];
+                m_counts[v] += banks[column][0][v];
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_total += static_cast<uint64_t>(last - first) * m_width;
+}
+
+void Histogram::compute(Buffer2DView<const unsigned char> plane)
+{
+    reset(plane.width(), plane.height());
+    ThreadPool::shared().parallelFor(plane.height(), ThreadPool::grainFor(plane.width()), [&](int first, int last)
+    {
+        addRows(plane, first, last);
+    });
+}
+
+bool Histogram::covers(int width, int height) const
+{
+    return m_width == width && m_height == height && m_total == static_cast<uint64_t>(width) * height;
+}
+
+void Histogram::levelsMap(const uint32_t *counts, unsigned char map[256])
+{
+    uint64_t total = 0;
+    for (int v = 0; v < 256; ++v)
+        total += counts[v];
+
+    // skip the darkest and the lightest pixels up to the clipped share
+    const uint64_t clip = total * LEVELS_CLIP / 1000;
+    int low = 0, high = 255;
+    uint64_t below = 0, above = 0;
+    while (low < 255 && below + counts[low] <= clip)
+        below += counts[low++];
+    while (high > low && above + counts[high] <= clip)
+        above += counts[high--];
+
+    for (int v = 0; v < 256; ++v)
+    {
+        if (high <= low)
+            map[v] = static_cast<unsigned char>(v);
+        else
+            map[v] = static_cast<unsigned char>(std::min(std::max(((v - low) * 255 + (high - low) / 2) / (high - low), 0), 255));
+    }
+}
+
+void Histogram::gammaMap(double gamma, const uint32_t *counts, unsigned char map[256])
+{
+    if (gamma <= 0)
+    {
+        // the mean grey value m goes to 1/2: m^(1 / gamma) = 1/2
+        uint64_t total = 0, sum = 0;
+        for (int v = 0; v < 256; ++v)
+        {
+            total += counts[v];
+            sum += static_cast<uint64_t>(v) * counts[v];
+        }
+        const double mean = total ? static_cast<double>(sum) / total / 255 : 0.5;
+        gamma = mean > 0 && mean < 1 ? std::min(std::max(std::log(mean) / std::log(0.5), 0.2), 5.0) : 1.0;
+    }
+
+    for (int v = 0; v < 256; ++v)
+        map[v] = static_cast<unsigned char>(std::lround(255 * std::pow(v / 255.0, 1 / gamma)));
+}
+
+void Histogram::equalize(int clip, const Histogram &histogram, Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target)
+{
+    const int width = source.width(), height = source.height();
+    if (width == 0 || height == 0)
+        return;
+
+    // the map of every tile, by tile row and column
+    std::vector<unsigned char> maps(TILES * TILES * 256);
+    for (int row = 0; row < TILES; ++row)
+    {
+        for (int column = 0; column < TILES; ++column)
+            tileMap(histogram.tile(column, row), clip, &maps[(row * TILES + column) * 256]);
+    }
+
+    std::vector<unsigned char> tiles(width);
+    std::vector<uint16_t> weights(width);
+    for (int x = 0; x < width; ++x)
+    {
+        int tile, weight;
+        interpolation(x, width, tile, weight);
+        tiles[x] = static_cast<unsigned char>(tile);
+        weights[x] = static_cast<uint16_t>(weight);
+    }
+
+    ThreadPool::shared().parallelFor(height, ThreadPool::grainFor(width), [&](int first, int last)
+    {
+        // the maps of the tile row above and below the row, blended by the row in 1/256
+        uint16_t blended[TILES][256];
+        for (int y = first; y < last; ++y)
+        {
+            int top, down;
+            interpolation(y, height, top, down);
+            const int bottom = std::min(top + 1, TILES - 1);
+            for (int column = 0; column < TILES; ++column)
+            {
+                const unsigned char *upper = &maps[(top * TILES + column) * 256], *lower = &maps[(bottom * TILES + column) * 256];
+                for (int v = 0; v < 256; ++v)
+                    blended[column][v] = static_cast<uint16_t>(upper[v] * (256 - down) + lower[v] * down);
+            }
+
+            const unsigned char *grey = source.row(y);
+            unsigned char *out = target.row(y);
+            for (int x = 0; x < width; ++x)
+            {
+                const int left = tiles[x], right = std::min(left + 1, TILES - 1);
+                const uint32_t value = blended[left][grey[x]] * static_cast<uint32_t>(256 - weights[x]) + blended[right][grey[x]] * static_cast<uint32_t>(weights[x]);
+                out[x] = static_cast<unsigned char>((value + 32768) >> 16);
+            }
+        }
+    });
+}
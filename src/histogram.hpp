@@ -0,0 +1,130 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "buffer2d.hpp"
+#include <cstdint>
+#include <mutex>
+
+/**
+ * @class Histogram
+ * @brief The histograms of a grey plane and the contrast filters computed from them.
+ *
+ * The plane is divided into TILES x TILES tiles, every tile has its own histogram and the
+ * histogram of the whole plane is their sum. Rows are counted right after they are written
+ * (by the luminance pass or by a loader), while they are still in the cache, so the histogram
+ * costs no pass of its own. A band of rows counts into BANKS sub-histograms which take the
+ * bytes in turn, so that runs of equal grey values do not wait for the store of the same counter,
+ * and adds them to the shared counts under a lock once per tile row.
+ *
+ * Auto levels and gamma curves are point filters built from the histogram of the whole plane.
+ * The local equalization (CLAHE) maps every tile through its clipped and equalized histogram and
+ * interpolates the maps of the four nearest tiles, so the tiles leave no seams.
+ */
+class Histogram
+{
+public:
+    /** The number of tiles across and down the plane. */
+    static constexpr int TILES = 8;
+
+    /** The number of sub-histograms a band of rows counts into. */
+    static constexpr int BANKS = 4;
+
+    /** The share of the pixels at both ends of the histogram which auto levels clip, in 1/1000. */
+    static constexpr int LEVELS_CLIP = 5;
+
+    /** The largest clip limit of the local equalization. */
+    static constexpr int MAX_CLIP = 16;
+
+private:
+    int m_width = 0;                     /**< The width of the plane. */
+    int m_height = 0;                    /**< The height of the plane. */
+    uint64_t m_total = 0;                /**< The number of pixels counted so far. */
+    uint32_t m_counts[256];              /**< The histogram of the whole plane. */
+    uint32_t m_tiles[TILES][TILES][256]; /**< The histogram of every tile, by tile row and column. */
+    std::mutex m_mutex;                  /**< Guards the counts while bands add to them. */
+
+public:
+    /**
+     * @brief Create the histogram of an empty plane.
+     */
+    Histogram();
+
+    Histogram(const Histogram &) = delete;
+    Histogram &operator=(const Histogram &) = delete;
+
+    /**
+     * @brief Remove all counts and set the size of the plane.
+     * @param width The width of the plane.
+     * @param height The height of the plane.
+     */
+    void reset(int width, int height);
+
+    /**
+     * @brief Count rows of the plane.
+     * @param plane The plane, of the size given to reset.
+     * @param first The index of the first row.
+     * @param last The index after the last row.
+     *
+     * Bands of rows can be counted in parallel, every row must be counted once.
+     */
+    void addRows(Buffer2DView<const unsigned char> plane, int first, int last);
+
+    /**
+     * @brief Count a whole plane on the thread pool.
+     * @param plane The plane.
+     */
+    void compute(Buffer2DView<const unsigned char> plane);
+
+    /**
+     * @brief Check whether all rows of a plane are counted.
+     * @param width The width of the plane.
+     * @param height The height of the plane.
+     * @return True if the histogram is complete for a plane of this size.
+     */
+    bool covers(int width, int height) const;
+
+    /**
+     * @brief Get the histogram of the whole plane.
+     * @return The number of pixels of every grey value.
+     */
+    const uint32_t *counts() const { return m_counts; }
+
+    /**
+     * @brief Get the histogram of a tile.
+     * @param column The tile column, 0 to TILES - 1.
+     * @param row The tile row, 0 to TILES - 1.
+     * @return The number of pixels of every grey value in the tile.
+     */
+    const uint32_t *tile(int column, int row) const { return m_tiles[row][column]; }
+
+    /**
+     * @brief Build the map which stretches the levels of a histogram to the full range.
+     * @param counts The histogram.
+     * @param map The new grey value of every grey value.
+     *
+     * LEVELS_CLIP / 1000 of the pixels at both ends become black and white. A histogram with a
+     * single level gives the identity.
+     */
+    static void levelsMap(const uint32_t *counts, unsigned char map[256]);
+
+    /**
+     * @brief Build a gamma curve.
+     * @param gamma The gamma, above 1 brightens the mid tones. 0 picks the gamma which maps the
+     *              mean grey value of the histogram to the middle grey.
+     * @param counts The histogram, only used when the gamma is picked.
+     * @param map The new grey value of every grey value.
+     */
+    static void gammaMap(double gamma, const uint32_t *counts, unsigned char map[256]);
+
+    /**
+     * @brief Equalize a plane locally (contrast limited adaptive histogram equalization).
+     * @param clip The clip limit, 1 to MAX_CLIP: no tile bin counts more than clip times the mean bin.
+     *             1 changes the plane the least, larger limits give more contrast.
+     * @param histogram The histogram of the source.
+     * @param source The source plane.
+     * @param target The target plane, of the same size and not overlapping the source.
+     */
+    static void equalize(int clip, const Histogram &histogram, Buffer2DView<const unsigned char> source, Buffer2DView<unsigned char> target);
+};
+
+#endif
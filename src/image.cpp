@@ -4,11 +4,19 @@
  */
 
 #include "image.hpp"
-#include <sys/ioctl.h>
+#include "luminance.hpp"
+#include "bytetable.hpp"
+#include "dither.hpp"
+#include "downscale.hpp"
+#include "terminal.hpp"
+#include "terminalscreen.hpp"
+#include "threadpool.hpp"
 #include <stdio.h>
 #include <unistd.h>
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <memory>
 
 /**
  * @brief Sets the transition string for converting grayscale values to ASCII symbols.
@@ -16,10 +24,216 @@
  */
 void Image::setTransition(const std::string &transition)
 {
-    m_transition = transition;
+    if (transition != m_transition)
+    {
+        m_transition = transition;
+        m_glyphs = GlyphTable(m_transition);
+        m_shapes = GlyphShapes(m_transition);
+        invalidate(STAGE_ASCII);
+    }
     std::cout << "Transition string set to: " << m_transition << std::endl;
 }
 
+/**
+ * @brief Chooses whether the image is loaded in streaming mode.
+ * @param streaming True to keep only the grey plane.
+ */
+void Image::setStreaming(bool streaming)
+{
+    m_streaming = streaming;
+}
+
+/**
+ * @brief Chooses whether a JPEG image is decoded to luma directly.
+ * @param luma True to let libjpeg output grayscale.
+ */
+void Image::setLumaDecode(bool luma)
+{
+    m_luma_decode = luma;
+}
+
+/**
+ * @brief Chooses whether the cells are colored.
+ * @param mode The color mode.
+ */
+void Image::setColorMode(AnsiColor::Mode mode)
+{
+    if (mode != m_color_mode)
+    {
+        m_color_mode = mode;
+        invalidate(STAGE_COLOR);
+    }
+}
+
+/**
+ * @brief Prepares the image planes for decoding.
+ * @param width The width of the decoded image.
+ * @param height The height of the decoded image.
+ */
+void Image::beginRows(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    m_histogram.reset(width, height);
+
+    if (m_streaming)
+    {
+        m_raw_image.clear();
+        m_row_batch.resize(width, ROW_BATCH);
+        m_grey_image.resize(width, height);
+    }
+    else
+    {
+        m_raw_image.resize(width, height);
+    }
+}
+
+/**
+ * @brief Gets the buffer a loader decodes a row to.
+ * @param y The index of the row in the image.
+ * @return The pointer to the row.
+ */
+Image::Pixel *Image::decodeRow(int y)
+{
+    return m_streaming ? m_row_batch.row(y % ROW_BATCH) : m_raw_image.row(y);
+}
+
+/**
+ * @brief Converts decoded rows to the grey plane in streaming mode.
+ * @param first The index of the first decoded row.
+ * @param count The number of decoded rows.
+ */
+void Image::finishRows(int first, int count)
+{
+    if (!m_streaming)
+        return;
+
+    for (int y = first; y < first + count; ++y)
+    {
+        Luminance::convertRow(reinterpret_cast<const unsigned char *>(m_row_batch.row(y % ROW_BATCH)), m_grey_image.row(y), m_width);
+    }
+    m_histogram.addRows(m_grey_image.view(), first, first + count);
+}
+
+/**
+ * @brief Finishes decoding.
+ */
+void Image::endRows()
+{
+    m_filters.reset();
+    m_history.clear();
+    if (!m_streaming)
+    {
+        invalidate(STAGE_GREY);
+        return;
+    }
+
+    // the grey plane is already converted
+    m_row_batch.clear();
+    m_dirty[STAGE_GREY] = false;
+    invalidate(STAGE_FILTERED);
+}
+
+/**
+ * @brief Prepares the image planes for decoding grey rows directly.
+ * @param width The width of the decoded image.
+ * @param height The height of the decoded image.
+ */
+void Image::beginGreyRows(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    m_histogram.reset(width, height);
+
+    m_raw_image.clear();
+    m_grey_image.resize(width, height);
+}
+
+/**
+ * @brief Adds decoded grey rows to the histogram.
+ * @param first The index of the first decoded row.
+ * @param count The number of decoded rows.
+ */
+void Image::finishGreyRows(int first, int count)
+{
+    m_histogram.addRows(m_grey_image.view(), first, first + count);
+}
+
+/**
+ * @brief Finishes decoding grey rows.
+ */
+void Image::endGreyRows()
+{
+    m_filters.reset();
+    m_history.clear();
+    m_dirty[STAGE_GREY] = false;
+    invalidate(STAGE_FILTERED);
+}
+
+/**
+ * @brief Reports why a load failed.
+ * @param message The reason.
+ */
+void Image::reportError(const std::string &message)
+{
+    m_error = message;
+    if (m_print_errors)
+        std::cout << message << std::endl;
+}
+
+/**
+ * @brief Chooses the kind of cells the image is shown with.
+ * @param mode The render mode.
+ */
+void Image::setRenderMode(CellEncoding::Mode mode)
+{
+    if (mode != m_render_mode)
+    {
+        m_render_mode = mode;
+        invalidate(STAGE_SCALED);
+    }
+}
+
+/**
+ * @brief Chooses how the cells are dithered.
+ * @param mode The kind of dithering.
+ */
+void Image::setDitherMode(Dither::Mode mode)
+{
+    if (mode != m_dither_mode)
+    {
+        m_dither_mode = mode;
+        invalidate(STAGE_ASCII);
+    }
+}
+
+/**
+ * @brief Gets the encoding of the cells.
+ * @return The encoding.
+ */
+const CellEncoding &Image::getEncoding() const
+{
+    return CellEncoding::get(m_render_mode);
+}
+
+/**
+ * @brief Chooses whether load errors are printed.
+ * @param print True to print them.
+ */
+void Image::setPrintErrors(bool print)
+{
+    m_print_errors = print;
+}
+
+/**
+ * @brief Gets the reason the last load failed.
+ * @return The reason.
+ */
+const std::string &Image::getError() const
+{
+    return m_error;
+}
+
 /**
  * @brief Sets the path of the image.
  * @param path The path of the image.
@@ -43,14 +257,201 @@ std::string &Image::getPath()
  */
 void Image::toGreyScale()
 {
-    m_grey_image.resize(m_height, std::vector<unsigned char>(m_width));
-    for (int y = 0; y < m_height; ++y)
+    m_filters.reset();
+    updateGrey();
+}
+
+/**
+ * @brief Marks a stage and all stages after it as out of date.
+ * @param stage The first stage to recompute.
+ */
+void Image::invalidate(Stage stage)
+{
+    for (int i = stage; i < STAGE_COUNT; ++i)
     {
-        for (int x = 0; x < m_width; ++x)
+        m_dirty[i] = true;
+    }
+}
+
+/**
+ * @brief Computes the grey plane from the raw image if it is out of date.
+ */
+void Image::updateGrey()
+{
+    static_assert(sizeof(Pixel) == 3, "Pixel must be 3 interleaved bytes");
+
+    // In streaming mode and with luma decoding there is no raw image, the grey plane is the loaded one
+    if (!m_dirty[STAGE_GREY] || m_raw_image.empty())
+        return;
+
+    // the histogram counts every band right after its luminance pass, while the rows are in the cache
+    m_grey_image.resize(m_width, m_height);
+    m_histogram.reset(m_width, m_height);
+    ThreadPool::shared().parallelFor(m_height, ThreadPool::grainFor(m_width), [this](int first, int last)
+    {
+        for (int y = first; y < last; ++y)
         {
-            m_grey_image[y][x] = m_raw_image[y][x].getGrey();
+            Luminance::convertRow(reinterpret_cast<const unsigned char *>(m_raw_image.row(y)), m_grey_image.row(y), m_width);
         }
+        m_histogram.addRows(m_grey_image.view(), first, last);
+    });
+    m_dirty[STAGE_GREY] = false;
+}
+
+/**
+ * @brief Applies the filters to the grey plane if the filtered plane is out of date.
+ */
+void Image::updateFiltered()
+{
+    if (!m_dirty[STAGE_FILTERED] && m_filters == m_applied_filters)
+        return;
+
+    m_applied_filters = m_filters;
+    if (m_dirty[STAGE_FILTERED])
+    {
+        if (m_applied_filters.isIdentity())
+        {
+            m_filtered_image.clear();
+        }
+        else
+        {
+            m_filtered_image.resize(m_width, m_height);
+            m_applied_filters.apply(m_grey_image.view(), m_filtered_image.view(), &m_histogram);
+        }
+        m_dirty[STAGE_FILTERED] = false;
     }
+    updateTone();
+
+    // undo and redo restore a step with the same filters, which is not a new edit
+    if (!m_history.current() || m_history.current()->filters != m_applied_filters)
+        m_history.push(m_applied_filters, m_filtered_image.view());
+}
+
+/**
+ * @brief Builds the tone curves of the applied filters.
+ */
+void Image::updateTone()
+{
+    if (!m_applied_filters.hasTones())
+        return;
+
+    uint32_t counts[256] = {};
+    if (m_applied_filters.hasSpatial())
+    {
+        std::unique_ptr<Histogram> filtered = std::make_unique<Histogram>();
+        filtered->compute(m_filtered_image.view());
+        std::copy(filtered->counts(), filtered->counts() + 256, counts);
+    }
+    else
+    {
+        // the loaders count the grey plane, only a plane from elsewhere is counted here
+        if (!m_histogram.covers(m_width, m_height))
+            m_histogram.compute(m_grey_image.view());
+        const unsigned char *table = m_applied_filters.table();
+        for (int i = 0; i < 256; ++i)
+            counts[table[i]] += m_histogram.counts()[i];
+    }
+    m_applied_filters.toneTable(counts, m_tone);
+}
+
+/**
+ * @brief Makes a step of the history the current state.
+ * @param step The step.
+ */
+void Image::restoreStep(const EditHistory::Step &step)
+{
+    m_filters = step.filters;
+    if (!step.filters.isIdentity() && (step.filtered.width() != m_width || step.filtered.height() != m_height))
+    {
+        // the tiles were dropped, apply the filters again
+        invalidate(STAGE_FILTERED);
+        return;
+    }
+
+    m_applied_filters = step.filters;
+    if (m_applied_filters.isIdentity())
+    {
+        m_filtered_image.clear();
+    }
+    else
+    {
+        m_filtered_image.resize(m_width, m_height);
+        step.filtered.restore(m_filtered_image.view());
+    }
+    m_dirty[STAGE_FILTERED] = false;
+    updateTone();
+    invalidate(STAGE_SCALED);
+}
+
+/**
+ * @brief Goes back to the filters before the last edit.
+ * @return True if there was an edit to undo, false otherwise.
+ */
+bool Image::undoEdit()
+{
+    const EditHistory::Step *step = m_history.undo();
+    if (!step)
+        return false;
+    restoreStep(*step);
+    return true;
+}
+
+/**
+ * @brief Goes forward to the filters of an undone edit.
+ * @return True if there was an edit to redo, false otherwise.
+ */
+bool Image::redoEdit()
+{
+    const EditHistory::Step *step = m_history.redo();
+    if (!step)
+        return false;
+    restoreStep(*step);
+    return true;
+}
+
+/**
+ * @brief Sets the memory limit of the edit history.
+ * @param bytes The limit in bytes.
+ */
+void Image::setHistoryLimit(size_t bytes)
+{
+    m_history.setLimit(bytes);
+}
+
+/**
+ * @brief Gets the edit history.
+ * @return The history.
+ */
+const EditHistory &Image::getHistory() const
+{
+    return m_history;
+}
+
+/**
+ * @brief Gets the ASCII representation of the image.
+ * @return The glyph grid.
+ */
+Buffer2DView<const char> Image::getAsciiArt() const
+{
+    return m_scaled_ascii_image.view();
+}
+
+/**
+ * @brief Gets the colors of the ASCII representation.
+ * @return The color codes.
+ */
+Buffer2DView<const uint32_t> Image::getColors() const
+{
+    return m_scaled_color_image.view();
+}
+
+/**
+ * @brief Gets the output of the filtered stage.
+ * @return The filtered plane, or the grey plane when no filters are applied.
+ */
+Buffer2DView<const unsigned char> Image::filteredView() const
+{
+    return m_applied_filters.isIdentity() ? m_grey_image.view() : m_filtered_image.view();
 }
 
 /**
@@ -60,23 +461,116 @@ void Image::toGreyScale()
  */
 char Image::greyToAsciiSymbol(int brightness)
 {
-    int index = brightness * (m_transition.size() - 1) / 255;
-    return m_transition[index];
+    return m_glyphs[static_cast<unsigned char>(brightness)];
 }
 
 /**
- * @brief Converts the grayscale image to ASCII art.
+ * @brief Converts the scaled grayscale image to ASCII art.
  */
 void Image::convertGreyToAscii()
 {
-    m_ascii_image.resize(m_height, std::vector<char>(m_width));
-    for (int y = 0; y < m_height; ++y)
+    const CellEncoding &encoding = getEncoding();
+    const int width = m_scaled_grey_image.width() / encoding.subColumns();
+    const int subRows = encoding.subRows();
+    m_scaled_ascii_image.resize(width, m_scaled_grey_image.height() / subRows);
+
+    // dithering quantizes to the glyphs of the transition string or to dark and light pixels,
+    // the shape mode matches the pixels themselves
+    Buffer2DView<const unsigned char> grey = m_scaled_grey_image.view();
+    const int levels = encoding.mode() == CellEncoding::MODE_ASCII ? std::min<int>(m_transition.size(), 256) : 2;
+    const bool dither = m_dither_mode != Dither::MODE_NONE && encoding.mode() != CellEncoding::MODE_SHAPE && levels >= 2;
+
+    // the tone curves are merged into the glyphs of the ASCII mode, the other modes and dithering need the toned pixels
+    const bool toned = m_applied_filters.hasTones();
+    const bool merged = toned && encoding.mode() == CellEncoding::MODE_ASCII && !dither;
+    const GlyphTable glyphs = merged ? GlyphTable(m_glyphs, m_tone) : m_glyphs;
+    if (toned && !merged)
+    {
+        m_toned_image.resize(grey.width(), grey.height());
+        ThreadPool::shared().parallelFor(grey.height(), ThreadPool::grainFor(grey.width()), [&](int first, int last)
+        {
+            for (int y = first; y < last; ++y)
+                ByteTable::mapRow(m_tone, grey.row(y), m_toned_image.row(y), grey.width());
+        });
+        grey = m_toned_image.view();
+    }
+    else
+    {
+        m_toned_image.clear();
+    }
+
+    if (dither)
+    {
+        m_dithered_image.resize(m_scaled_grey_image.width(), m_scaled_grey_image.height());
+        Dither::apply(m_dither_mode, grey, m_dithered_image.view(), levels);
+        grey = m_dithered_image.view();
+    }
+    else
+    {
+        m_dithered_image.clear();
+    }
+
+    ThreadPool::shared().parallelFor(m_scaled_ascii_image.height(), ThreadPool::grainFor(width * subRows), [&](int first, int last)
     {
-        for (int x = 0; x < m_width; ++x)
+        GlyphShapes::Cache cache;
+        for (int y = first; y < last; ++y)
         {
-            m_ascii_image[y][x] = greyToAsciiSymbol(m_grey_image[y][x]);
+            if (encoding.mode() == CellEncoding::MODE_HALF_BLOCK)
+            {
+                CellEncoding::halfBlockRow(grey.row(2 * y), grey.row(2 * y + 1), m_scaled_ascii_image.row(y), width);
+            }
+            else if (encoding.mode() == CellEncoding::MODE_BRAILLE)
+            {
+                const unsigned char *rows[4] = {grey.row(4 * y), grey.row(4 * y + 1), grey.row(4 * y + 2), grey.row(4 * y + 3)};
+                CellEncoding::brailleRow(rows, m_scaled_ascii_image.row(y), width);
+            }
+            else if (encoding.mode() == CellEncoding::MODE_SHAPE)
+            {
+                const unsigned char *rows[GlyphShapes::ROWS];
+                for (int row = 0; row < GlyphShapes::ROWS; ++row)
+                    rows[row] = grey.row(GlyphShapes::ROWS * y + row);
+                m_shapes.matchRow(rows, glyphs, m_scaled_ascii_image.row(y), width, cache);
+            }
+            else
+            {
+                glyphs.mapRow(grey.row(y), m_scaled_ascii_image.row(y), width);
+            }
         }
+    });
+    m_dirty[STAGE_ASCII] = false;
+}
+
+/**
+ * @brief Sets the size the image is going to be displayed at.
+ * @param columns The number of terminal columns, 0 for the full resolution.
+ * @param rows The number of terminal rows, 0 for the full resolution.
+ */
+void Image::setTargetSize(int columns, int rows)
+{
+    m_target_columns = columns;
+    m_target_rows = rows;
+}
+
+/**
+ * @brief Gets the largest reduction of the decoded image which still gives a pixel for every cell.
+ * @param width The full width of the image.
+ * @param height The full height of the image.
+ * @return 1, 2, 4 or 8.
+ */
+int Image::decodeDenominator(int width, int height) const
+{
+    if (m_target_columns <= 0 || m_target_rows <= 0 || width <= 0 || height <= 0)
+        return 1;
+
+    // the same fit as in resizeAsciiImage: characters are twice as tall as wide
+    double scale = std::min({1.0, (double)m_target_columns / width, (double)m_target_rows / (0.5 * height)});
+
+    for (int denominator = 8; denominator > 1; denominator /= 2)
+    {
+        if (denominator * scale <= 1.0)
+            return denominator;
     }
+    return 1;
 }
 
 /**
@@ -84,16 +578,37 @@ void Image::convertGreyToAscii()
  */
 void Image::resizeAsciiImage()
 {
-    if (!m_scaled_ascii_image.empty() && m_scaled_ascii_image.size() == static_cast<size_t>(m_width) && m_scaled_ascii_image[0].size() == static_cast<size_t>(m_height))
+    // new tone curves only map the cells again
+    if (m_filters != m_applied_filters)
+        invalidate(m_filters.samePlane(m_applied_filters) ? STAGE_COLOR : STAGE_FILTERED);
+    // the resize generation only changes in the SIGWINCH handler, so checking it costs no system call
+    if (m_resize_generation != Terminal::resizeGeneration())
+        invalidate(STAGE_SCALED);
+
+    updateGrey();
+    updateFiltered();
+    updateScaled();
+    updateColors();
+    if (m_dirty[STAGE_ASCII])
+        convertGreyToAscii();
+}
+
+/**
+ * @brief Averages the filtered plane down to the terminal cells if the scaled plane is out of date.
+ */
+void Image::updateScaled()
+{
+    if (!m_dirty[STAGE_SCALED])
         return;
 
-    struct winsize w;
-    ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
-    int terminal_width = w.ws_col;
-    int terminal_height = w.ws_row;
+    m_resize_generation = Terminal::resizeGeneration();
+    int terminal_width, terminal_height;
+    Terminal::getSize(terminal_width, terminal_height);
 
-    int width = m_width;
-    int height = 0.5 * m_height;
+    // a cell is twice as high as wide: it covers 1 x 2 pixels of the image, or 2 x 4 with Braille
+    const CellEncoding &encoding = getEncoding();
+    int width = m_width / encoding.subColumns();
+    int height = 0.5 * m_height / encoding.subColumns();
 
     if (width > terminal_width)
     {
@@ -108,19 +623,60 @@ void Image::resizeAsciiImage()
         width = width * scale;
     }
 
-    m_scaled_ascii_image.clear();
-    m_scaled_ascii_image.resize(height, std::vector<char>(width));
+    width = std::max(width, 1);
+    height = std::max(height, 1);
 
-    double x_scale = (double)m_width / width;
-    double y_scale = (double)m_height / height;
+    // average the grey plane down to the cells first, so that glyphs are only mapped for the cells
+    m_scaled_grey_image.resize(width * encoding.subColumns(), height * encoding.subRows());
+    Downscale::areaAverage(filteredView(), m_scaled_grey_image.view());
+    m_dirty[STAGE_SCALED] = false;
+}
 
-    for (int y = 0; y < height; ++y)
+/**
+ * @brief Recomputes the color stage if it is dirty.
+ */
+void Image::updateColors()
+{
+    if (!m_dirty[STAGE_COLOR])
+        return;
+    m_dirty[STAGE_COLOR] = false;
+
+    if (m_color_mode == AnsiColor::MODE_NONE || m_raw_image.empty())
     {
-        for (int x = 0; x < width; ++x)
+        m_scaled_raw_image.clear();
+        m_scaled_color_image.clear();
+        return;
+    }
+
+    // the components are averaged like grey values, as interleaved bytes
+    static_assert(sizeof(Pixel) == 3, "pixels must be three interleaved bytes");
+    const int width = m_scaled_grey_image.width() / getEncoding().subColumns();
+    const int height = m_scaled_grey_image.height() / getEncoding().subRows();
+    m_scaled_raw_image.resize(width, height);
+    Downscale::areaAverage(Buffer2DView<const unsigned char>(reinterpret_cast<const unsigned char *>(m_raw_image.row(0)),
+                                                             m_raw_image.width() * 3, m_raw_image.height(), m_raw_image.stride() * 3),
+                           Buffer2DView<unsigned char>(reinterpret_cast<unsigned char *>(m_scaled_raw_image.row(0)),
+                                                       width * 3, height, m_scaled_raw_image.stride() * 3),
+                           3);
+
+    m_scaled_color_image.resize(width, height);
+    unsigned char table[256];
+    for (int i = 0; i < 256; ++i)
+        table[i] = m_applied_filters.hasTones() ? m_tone[m_applied_filters.table()[i]] : m_applied_filters.table()[i];
+    const bool mirror = m_applied_filters.isMirrored(), flip = m_applied_filters.isFlipped();
+    ThreadPool::shared().parallelFor(height, ThreadPool::grainFor(width), [&](int first, int last)
+    {
+        for (int y = first; y < last; ++y)
         {
-            m_scaled_ascii_image[y][x] = m_ascii_image[y * y_scale][x * x_scale];
+            const Pixel *source = m_scaled_raw_image.row(flip ? height - 1 - y : y);
+            uint32_t *colors = m_scaled_color_image.row(y);
+            for (int x = 0; x < width; ++x)
+            {
+                const Pixel &pixel = source[mirror ? width - 1 - x : x];
+                colors[x] = AnsiColor::quantize(m_color_mode, table[pixel.red], table[pixel.green], table[pixel.blue]);
+            }
         }
-    }
+    });
 }
 
 /**
@@ -129,13 +685,7 @@ void Image::resizeAsciiImage()
 void Image::negateImage()
 {
     std::cout << "negateImage" << std::endl;
-    for (int y = 0; y < m_height; ++y)
-    {
-        for (int x = 0; x < m_width; ++x)
-        {
-            m_grey_image[y][x] = 255 - m_grey_image[y][x];
-        }
-    }
+    m_filters.negate();
 }
 
 /**
@@ -143,13 +693,7 @@ void Image::negateImage()
  */
 void Image::mirrorImage()
 {
-    for (int y = 0; y < m_height; ++y)
-    {
-        for (int x = 0; x < m_width / 2; ++x)
-        {
-            std::swap(m_grey_image[y][x], m_grey_image[y][m_width - x - 1]);
-        }
-    }
+    m_filters.mirror();
 }
 
 /**
@@ -158,13 +702,43 @@ void Image::mirrorImage()
  */
 void Image::changeBrigtness(int delta)
 {
-    for (int y = 0; y < m_height; ++y)
-    {
-        for (int x = 0; x < m_width; ++x)
-        {
-            m_grey_image[y][x] = std::min(std::max(m_grey_image[y][x] + delta, 0), 255);
-        }
-    }
+    m_filters.brightness(delta);
+}
+
+/**
+ * @brief Blurs, sharpens or detects the edges of the image.
+ * @param kind The spatial filter.
+ * @param radius The radius of the filter in pixels.
+ */
+void Image::convolveImage(Convolution::Kind kind, int radius)
+{
+    m_filters.convolve(kind, radius);
+}
+
+/**
+ * @brief Equalizes the histogram of the image locally.
+ * @param clip The clip limit.
+ */
+void Image::equalizeImage(int clip)
+{
+    m_filters.equalize(clip);
+}
+
+/**
+ * @brief Stretches the grey values of the image to the full range.
+ */
+void Image::stretchLevels()
+{
+    m_filters.autoLevels();
+}
+
+/**
+ * @brief Applies a gamma curve to the image.
+ * @param gamma The gamma, 0 to pick it from the histogram.
+ */
+void Image::changeGamma(double gamma)
+{
+    m_filters.gamma(gamma);
 }
 
 /**
@@ -172,13 +746,7 @@ void Image::changeBrigtness(int delta)
  */
 void Image::printAsciiArt()
 {
-    std::cout << "\033[2J\033[1;1H";
-    for (size_t y = 0; y < m_scaled_ascii_image.size(); ++y)
-    {
-        for (size_t x = 0; x < m_scaled_ascii_image[0].size(); ++x)
-        {
-            std::cout << m_scaled_ascii_image[y][x];
-        }
-        std::cout << std::endl;
-    }
+    // the menus follow the image, so every row ends with a newline
+    TerminalScreen::renderFull(getAsciiArt(), getColors(), getEncoding(), m_frame, true);
+    Terminal::write(m_frame);
 }
@@ -1,6 +1,16 @@
 #ifndef IMAGE_H
 #define IMAGE_H
 
+#include "ansicolor.hpp"
+#include "buffer2d.hpp"
+#include "cellencoding.hpp"
+#include "edithistory.hpp"
+#include "filterchain.hpp"
+#include "dither.hpp"
+#include "glyphshapes.hpp"
+#include "glyphtable.hpp"
+#include "histogram.hpp"
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <cmath>
@@ -39,14 +49,190 @@ protected:
     int m_width;  /**< The width of the image. */
     int m_height; /**< The height of the image. */
 
-    std::vector<std::vector<Pixel>> m_raw_image;          /**< The raw image data. */
-    std::vector<std::vector<unsigned char>> m_grey_image; /**< The grayscale image data. */
-    std::vector<std::vector<char>> m_ascii_image;         /**< The ASCII representation of the image. */
-    std::vector<std::vector<char>> m_scaled_ascii_image;  /**< The scaled ASCII representation of the image. */
+    Buffer2D<Pixel> m_raw_image;                 /**< The raw image data. */
+    Buffer2D<unsigned char> m_grey_image;        /**< The grayscale image data. */
+    Buffer2D<unsigned char> m_filtered_image;    /**< The grayscale image with the filters applied, empty without filters. */
+    Buffer2D<unsigned char> m_scaled_grey_image; /**< The grayscale image averaged down to the pixels of the terminal cells. */
+    Buffer2D<unsigned char> m_toned_image;       /**< The scaled grayscale image through the tone curves, empty without them or when they are merged into the glyphs. */
+    Buffer2D<unsigned char> m_dithered_image;    /**< The scaled grayscale image quantized to the glyph levels, empty without dithering. */
+    Buffer2D<char> m_scaled_ascii_image;         /**< The scaled ASCII representation of the image, one CellEncoding value per cell. */
+    Buffer2D<Pixel> m_scaled_raw_image;          /**< The raw image averaged down to the terminal cells, in color mode. */
+    Buffer2D<uint32_t> m_scaled_color_image;     /**< The AnsiColor code of every cell, empty without colors. */
+    AnsiColor::Mode m_color_mode = AnsiColor::MODE_NONE; /**< The color sequences the cells are quantized for. */
+    CellEncoding::Mode m_render_mode = CellEncoding::MODE_ASCII; /**< The kind of cells the image is shown with. */
+    Dither::Mode m_dither_mode = Dither::MODE_NONE; /**< How the cells are dithered. */
 
     /**< The transition string used for ASCII conversion. */
-    std::string m_transition = "$@B%8&WM#*oahkbdpqwmZO0QLCJUYXzcvunxrjft/\\|()1{}[]?-_+~<>i!lI;:,\"^`'. ";
+    std::string m_transition = GlyphTable::DEFAULT_TRANSITION;
+    GlyphTable m_glyphs = GlyphTable::defaultTable(); /**< The glyph of every grey value for the transition string. */
+    GlyphShapes m_shapes; /**< The bitmaps of the glyphs of the transition string, for the shape mode. */
     std::string m_path; /**< The path to the image file. */
+    std::string m_error; /**< The reason the last load failed. */
+    std::string m_frame; /**< The terminal output of printAsciiArt, kept to reuse its capacity. */
+    bool m_print_errors = true; /**< Whether load errors are printed as well. */
+
+    /**
+     * @brief Report why a load failed.
+     * @param message The reason.
+     *
+     * The message is kept for getError and printed unless setPrintErrors(false) was called.
+     */
+    void reportError(const std::string &message);
+
+    bool m_streaming = false;     /**< Whether decoded rows go straight to the grey plane without keeping the raw image. */
+    bool m_luma_decode = false;   /**< Whether loaders which can decode grey directly skip the RGB image and the luminance pass. */
+
+    int m_target_columns = 0; /**< The number of terminal columns the image is decoded for, 0 for the full resolution. */
+    int m_target_rows = 0;    /**< The number of terminal rows the image is decoded for, 0 for the full resolution. */
+
+    /**
+     * @brief Get the largest reduction of the decoded image which still gives a pixel for every cell.
+     * @param width The full width of the image.
+     * @param height The full height of the image.
+     * @return The denominator of the reduction: 1, 2, 4 or 8.
+     *
+     * Loaders which can decode at a reduced size (JPEG in the IDCT) use this with the target size.
+     */
+    int decodeDenominator(int width, int height) const;
+
+    /**
+     * @enum Stage
+     * @brief The stages of the rendering pipeline: raw -> grey -> filtered -> scaled -> (color) -> ascii.
+     *
+     * Every stage keeps its output between calls and has a dirty flag. A change marks the stage
+     * it affects and all stages after it, resizeAsciiImage recomputes only the dirty ones.
+     */
+    enum Stage
+    {
+        STAGE_GREY,     /**< m_grey_image from m_raw_image. */
+        STAGE_FILTERED, /**< m_filtered_image from m_grey_image. */
+        STAGE_SCALED,   /**< m_scaled_grey_image from the filtered plane, with the pixels of all cells. */
+        STAGE_COLOR,    /**< m_scaled_color_image from m_raw_image, at the size of the scaled stage. */
+        STAGE_ASCII,    /**< m_scaled_ascii_image from m_scaled_grey_image, one cell from the pixels of the cell. */
+        STAGE_COUNT
+    };
+    bool m_dirty[STAGE_COUNT] = {true, true, true, true, true}; /**< Whether the output of each stage is out of date. */
+
+    /**
+     * @brief Mark a stage and all stages after it as out of date.
+     * @param stage The first stage to recompute.
+     */
+    void invalidate(Stage stage);
+
+    FilterChain m_filters;            /**< The filters chosen since the last toGreyScale. */
+    FilterChain m_applied_filters;    /**< The filters m_filtered_image was computed with. */
+    Histogram m_histogram;            /**< The histogram of the grey plane, counted as the rows are written. */
+    unsigned char m_tone[256];        /**< The tone curves of the applied filters, built from the histogram of the filtered stage. */
+    unsigned m_resize_generation = 0; /**< The terminal resize generation the scaled stage was computed for. */
+    EditHistory m_history;            /**< The filter edits since the image was loaded. */
+
+    /**
+     * @brief Make a step of the history the current state.
+     * @param step The step.
+     */
+    void restoreStep(const EditHistory::Step &step);
+
+    /**
+     * @brief Get the output of the filtered stage.
+     * @return The filtered plane, or the grey plane itself when no filters are applied.
+     */
+    Buffer2DView<const unsigned char> filteredView() const;
+
+    /**
+     * @brief Recompute the grey stage if it is dirty.
+     */
+    void updateGrey();
+
+    /**
+     * @brief Recompute the filtered stage if it is dirty.
+     *
+     * Filters which differ only in their tone curves keep the filtered plane.
+     */
+    void updateFiltered();
+
+    /**
+     * @brief Build the tone curves of the applied filters.
+     *
+     * The histogram of the filtered plane is the histogram of the grey plane through the point
+     * filters, only spatial filters make it count the filtered plane.
+     */
+    void updateTone();
+
+    /**
+     * @brief Recompute the scaled stage if it is dirty.
+     */
+    void updateScaled();
+
+    /**
+     * @brief Recompute the color stage if it is dirty.
+     *
+     * The raw image is averaged down to the cells, the point filters are applied to every
+     * component and mirror and flip move the cells. Without a color mode or without the raw
+     * image (streaming mode, luma decoding) the cells have no colors.
+     */
+    void updateColors();
+
+    static constexpr int ROW_BATCH = 16; /**< The number of decoded rows buffered in streaming mode. */
+    Buffer2D<Pixel> m_row_batch;     /**< The decoded rows waiting for the luminance pass in streaming mode. */
+
+    /**
+     * @brief Prepare the image planes for decoding.
+     * @param width The width of the decoded image.
+     * @param height The height of the decoded image.
+     *
+     * Loaders call this before the first row. In streaming mode only the grey plane and a small
+     * batch of rows are allocated, otherwise the raw image is.
+     */
+    void beginRows(int width, int height);
+
+    /**
+     * @brief Get the buffer a loader decodes a row to.
+     * @param y The index of the row in the image.
+     * @return The pointer to m_width pixels.
+     *
+     * In streaming mode the buffer is a slot in the row batch, which is reused every ROW_BATCH rows,
+     * so the row must be passed to finishRows before it is overwritten.
+     */
+    Pixel *decodeRow(int y);
+
+    /**
+     * @brief Tell the image that rows are decoded.
+     * @param first The index of the first decoded row.
+     * @param count The number of decoded rows, at most ROW_BATCH.
+     *
+     * In streaming mode the rows are converted to the grey plane right away.
+     */
+    void finishRows(int first, int count);
+
+    /**
+     * @brief Finish decoding.
+     *
+     * In streaming mode the row batch is released, otherwise the grey plane is marked as out of date.
+     */
+    void endRows();
+
+    /**
+     * @brief Prepare the image planes for decoding grey rows directly.
+     * @param width The width of the decoded image.
+     * @param height The height of the decoded image.
+     *
+     * Only the grey plane is allocated, the loader writes to m_grey_image rows and calls endGreyRows.
+     */
+    void beginGreyRows(int width, int height);
+
+    /**
+     * @brief Finish decoding grey rows.
+     */
+    void endGreyRows();
+
+    /**
+     * @brief Tell the image that grey rows are decoded.
+     * @param first The index of the first decoded row.
+     * @param count The number of decoded rows.
+     *
+     * The rows are added to the histogram while they are in the cache.
+     */
+    void finishGreyRows(int first, int count);
 
 public:
     /**
@@ -64,9 +250,93 @@ public:
      * @param transition The new transition string to set.
      *
      * The transition string is used to map grayscale values to ASCII characters during ASCII conversion.
+     * Only the ASCII stage is recomputed for a new transition string.
      */
     void setTransition(const std::string &transition);
 
+    /**
+     * @brief Choose whether the image is loaded in streaming mode.
+     * @param streaming True to keep only the grey plane, false to keep the raw image as well.
+     *
+     * In streaming mode the decoded rows go through the luminance pass batch by batch and the raw
+     * image is never stored, which needs about 1 byte per pixel instead of 4 (5 while filters are applied).
+     */
+    void setStreaming(bool streaming);
+
+    /**
+     * @brief Choose whether a JPEG image is decoded to luma directly.
+     * @param luma True to let libjpeg output grayscale, false for the gamma-correct luminance from RGB.
+     *
+     * Must be called before loadImage. With luma decoding libjpeg outputs the Y channel of the image,
+     * so chroma upsampling, the YCbCr to RGB conversion and the luminance pass are skipped.
+     * Y is the Rec. 601 weighted sum of the gamma-compressed components (0.299 R + 0.587 G + 0.114 B),
+     * while the default path applies the Rec. 709 weights to the linear components. Both agree on
+     * neutral greys, saturated colors come out darker in luma (pure red 76 instead of 127,
+     * pure blue 29 instead of 75). Other formats always use the default path.
+     */
+    void setLumaDecode(bool luma);
+
+    /**
+     * @brief Set the size the image is going to be displayed at.
+     * @param columns The number of terminal columns, 0 for the full resolution.
+     * @param rows The number of terminal rows, 0 for the full resolution.
+     *
+     * Must be called before loadImage. A JPEG image is then decoded at 1/2, 1/4 or 1/8 of its size
+     * if that still gives at least one pixel for every character of the scaled ASCII image.
+     * Other formats are always decoded at the full resolution.
+     */
+    void setTargetSize(int columns, int rows);
+
+    /**
+     * @brief Choose whether the cells are colored.
+     * @param mode The color sequences of the terminal, AnsiColor::MODE_NONE for glyphs only.
+     *
+     * The color of a cell is the average color of the pixels it covers. Colors need the raw
+     * image, images loaded in streaming mode or decoded to luma stay without colors.
+     */
+    void setColorMode(AnsiColor::Mode mode);
+
+    /**
+     * @brief Choose the kind of cells the image is shown with.
+     * @param mode The mode: glyphs of the transition string, half blocks, Braille patterns or glyphs by shape.
+     *
+     * Half blocks show two pixels per cell (upper and lower half) and Braille patterns 2 x 4,
+     * each pixel is either dark (below CellEncoding::THRESHOLD) or light. In the shape mode the
+     * glyph of the transition string whose bitmap is closest to the dark pixels of the 4 x 8 of
+     * the cell is taken, see GlyphShapes. The pixels are square, so no rows are dropped for the
+     * aspect ratio of the cells as in the ASCII mode.
+     */
+    void setRenderMode(CellEncoding::Mode mode);
+
+    /**
+     * @brief Choose how the cells are dithered.
+     * @param mode The kind of dithering, see Dither.
+     *
+     * Dithering spreads the difference between a pixel and its glyph (or dot) over the neighbouring
+     * cells, so gradients show as a mix of two glyphs instead of bands. The shape mode is not dithered.
+     */
+    void setDitherMode(Dither::Mode mode);
+
+    /**
+     * @brief Get the encoding of the cells of the ASCII representation.
+     * @return The encoding of the render mode.
+     */
+    const CellEncoding &getEncoding() const;
+
+    /**
+     * @brief Choose whether load errors are printed.
+     * @param print True to print them, false to only keep them for getError.
+     *
+     * Images loaded in parallel keep their errors, so that they can be reported per file.
+     */
+    void setPrintErrors(bool print);
+
+    /**
+     * @brief Get the reason the last load failed.
+     * @return The reason, empty if it is not known.
+     */
+    const std::string &getError() const;
+
     /**
      * @brief Set the path to the image file.
      * @param path The new path to set.
@@ -82,14 +352,18 @@ public:
     /**
      * @brief Convert the image to grayscale.
      *
-     * Each pixel in the image is converted to its grayscale equivalent.
+     * Each pixel in the image is converted to its grayscale equivalent, and the filters are removed.
+     * The grey plane is cached, the luminance pass only runs again after the image is loaded again.
      */
     void toGreyScale();
 
     /**
-     * @brief Convert the grayscale image to ASCII representation.
+     * @brief Convert the scaled grayscale image to ASCII representation.
      *
-     * Each grayscale pixel is mapped to an ASCII character based on the transition string.
+     * Each cell of the scaled grayscale image is mapped to an ASCII character based on the transition string.
+     * In the half-block and Braille modes the pixels of a cell are packed into its half blocks or dots instead,
+     * in the shape mode the glyph is matched to the pixels of the cell.
+     * resizeAsciiImage calls this, call it directly only to map the same cells with a new transition string.
      */
     void convertGreyToAscii();
 
@@ -103,7 +377,11 @@ public:
     /**
      * @brief Resize the ASCII representation of the image.
      *
-     * The ASCII image is resized to match the dimensions of the original image.
+     * The grayscale image is area-averaged down to the size which fits the terminal
+     * and the resulting cells are mapped to ASCII characters.
+     * Only the stages affected by the changes since the last call are recomputed: a terminal resize
+     * (tracked through SIGWINCH) recomputes the scaled and ASCII stages, different filters the filtered
+     * stage as well, and if nothing changed nothing is done.
      */
     void resizeAsciiImage();
 
@@ -111,6 +389,7 @@ public:
      * @brief Negate the colors of the image.
      *
      * Each pixel's color components are negated.
+     * Filters are only recorded, they are applied together to the grey plane when the image is resized.
      */
     void negateImage();
 
@@ -118,6 +397,7 @@ public:
      * @brief Mirror the image horizontally.
      *
      * The image is flipped horizontally.
+     * Filters are only recorded, they are applied together to the grey plane when the image is resized.
      */
     void mirrorImage();
 
@@ -126,13 +406,89 @@ public:
      * @param delta The amount to change the brightness by.
      *
      * The brightness of each pixel is adjusted by the specified delta value.
+     * Filters are only recorded, they are applied together to the grey plane when the image is resized.
      */
     void changeBrigtness(int delta);
 
+    /**
+     * @brief Blur, sharpen or detect the edges of the image.
+     * @param kind The spatial filter.
+     * @param radius Its radius in pixels of the image, see Convolution::apply.
+     *
+     * Spatial filters run on the full grey plane before the other filters, in the order they were chosen.
+     * Filters are only recorded, they are applied together to the grey plane when the image is resized.
+     */
+    void convolveImage(Convolution::Kind kind, int radius);
+
+    /**
+     * @brief Equalize the histogram of the image locally (CLAHE).
+     * @param clip The clip limit, see Histogram::equalize.
+     *
+     * The equalization is a spatial filter, see convolveImage.
+     */
+    void equalizeImage(int clip);
+
+    /**
+     * @brief Stretch the grey values of the image to the full range.
+     *
+     * The levels are taken from the histogram of the image after all other filters, see Histogram::levelsMap.
+     * Like gamma curves they are merged into the glyph mapping of the cells instead of changing the filtered image.
+     */
+    void stretchLevels();
+
+    /**
+     * @brief Apply a gamma curve to the image.
+     * @param gamma The gamma, above 1 brightens the mid tones, 0 picks it from the histogram, see Histogram::gammaMap.
+     *
+     * The curve is merged into the glyph mapping of the cells, after all other filters.
+     */
+    void changeGamma(double gamma);
+
+    /**
+     * @brief Go back to the filters before the last edit.
+     * @return True if there was an edit to undo, false otherwise.
+     *
+     * Every set of filters the image was resized with is an edit. The filtered plane of the
+     * edit is copied back from the history, the filters are applied again only if the history
+     * dropped it to stay within its memory limit.
+     */
+    bool undoEdit();
+
+    /**
+     * @brief Go forward to the filters of an undone edit.
+     * @return True if there was an edit to redo, false otherwise.
+     */
+    bool redoEdit();
+
+    /**
+     * @brief Set the memory limit of the edit history.
+     * @param bytes The limit in bytes.
+     */
+    void setHistoryLimit(size_t bytes);
+
+    /**
+     * @brief Get the edit history.
+     * @return The history, for reporting its size and memory use.
+     */
+    const EditHistory &getHistory() const;
+
+    /**
+     * @brief Get the ASCII representation of the image.
+     * @return The view of the glyph grid, valid until the next resizeAsciiImage.
+     */
+    Buffer2DView<const char> getAsciiArt() const;
+
+    /**
+     * @brief Get the colors of the ASCII representation.
+     * @return The AnsiColor code of every glyph, an empty view without colors.
+     */
+    Buffer2DView<const uint32_t> getColors() const;
+
     /**
      * @brief Print the ASCII representation of the image.
      *
-     * The ASCII art is printed to the standard output.
+     * The ASCII art is printed to the standard output. The whole frame is built in m_frame with
+     * TerminalScreen::renderFull, a newline after every row, and written at once with Terminal::write.
      */
     void printAsciiArt();
 
@@ -1,9 +1,11 @@
 #include "jpegimage.hpp"
+#include "filemapping.hpp"
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <csetjmp>
+#include <algorithm>
 
 /**
  * @brief Load a JPEG image from a file.
@@ -28,14 +30,14 @@ bool JpegImage::loadImage(const std::string &filename)
      * struct, to avoid dangling-pointer problems.
      */
     jpegErrorManager errorManager{};
+    // Scratch line for grayscale images, declared before setjmp so that its destructor is not skipped by longjmp
+    std::vector<unsigned char> greyLine;
 
-    // Convert filename to const char*
-    const char *filenameC = filename.c_str();
-
-    FILE *file = fopen(filenameC, "rb");
-    if (!file)
+    // The whole file as one byte span, memory-mapped if possible
+    FileMapping file;
+    if (!file.open(filename))
     {
-        std::cout << "There is no such image" << std::endl;
+        reportError("There is no such image");
         return false;
     }
     decompressInfo.err = jpeg_std_error(&errorManager.manager);
@@ -44,64 +46,107 @@ bool JpegImage::loadImage(const std::string &filename)
     // if decompress traces an error, then jpegDecompressErrorHandler calls this part of code
     if (setjmp(errorManager.jumpBuffer))
     {
+        // keep the message of libjpeg for getError
+        char message[JMSG_LENGTH_MAX];
+        (*decompressInfo.err->format_message)(reinterpret_cast<j_common_ptr>(&decompressInfo), message);
+        m_error = message;
 
         jpeg_destroy_decompress(&decompressInfo);
-        fclose(file);
         return false;
     }
 
     jpeg_create_decompress(&decompressInfo);
-    jpeg_stdio_src(&decompressInfo, file);
+    jpeg_mem_src(&decompressInfo, file.data(), file.size());
 
     // read metadata
     jpeg_read_header(&decompressInfo, true);
+
+    // let the IDCT decode at a reduced size if the target size does not need all pixels,
+    // output_width and output_height below are the reduced size
+    decompressInfo.scale_num = 1;
+    decompressInfo.scale_denom = decodeDenominator(decompressInfo.image_width, decompressInfo.image_height);
+
+    // with luma decoding libjpeg outputs only the Y channel, without chroma upsampling and color conversion
+    if (m_luma_decode)
+        decompressInfo.out_color_space = JCS_GRAYSCALE;
     jpeg_start_decompress(&decompressInfo);
 
     // color components (RGB, YCbCr, CMYK, etc.)
-    auto components = static_cast<size_t>(decompressInfo.num_components);
+    auto components = static_cast<size_t>(decompressInfo.output_components);
     m_height = decompressInfo.output_height;
     m_width = decompressInfo.output_width;
 
     if (!m_height || !m_width || !components || components > 3)
+    {
+        m_error = "Unsupported JPEG color format";
+        jpeg_destroy_decompress(&decompressInfo);
         return false;
+    }
 
-    size_t lineWidth = components * m_width;
-    std::vector<unsigned char> data(m_height * lineWidth);
-    while (decompressInfo.output_scanline < decompressInfo.output_height)
+    if (m_luma_decode)
     {
-        // pointer to data + current line * lineWidth
-        unsigned char *rowptr = data.data() + decompressInfo.output_scanline * lineWidth;
-        // read 1 line to rowptr
-        jpeg_read_scanlines(&decompressInfo, &rowptr, 1);
-    }
+        // the scanlines are the rows of the grey plane
+        beginGreyRows(m_width, m_height);
+        while (decompressInfo.output_scanline < decompressInfo.output_height)
+        {
+            int first = decompressInfo.output_scanline;
+            int batch = std::min<int>(ROW_BATCH, m_height - first);
+
+            JSAMPROW rows[ROW_BATCH];
+            for (int i = 0; i < batch; ++i)
+            {
+                rows[i] = m_grey_image.row(first + i);
+            }
+            int count = jpeg_read_scanlines(&decompressInfo, rows, batch);
+            finishGreyRows(first, count);
+        }
+        endGreyRows();
 
-    jpeg_finish_decompress(&decompressInfo);
-    jpeg_destroy_decompress(&decompressInfo);
+        jpeg_finish_decompress(&decompressInfo);
+        jpeg_destroy_decompress(&decompressInfo);
+
+        return true;
+    }
 
-    m_raw_image.resize(m_height, std::vector<Pixel>(m_width));
+    beginRows(m_width, m_height);
+    greyLine.resize(components == 1 ? ROW_BATCH * m_width : 0);
 
-    // convert components data to pixels data
-    size_t row = 0, col = 0;
-    for (size_t dataI = 0; dataI < data.size(); dataI += components)
+    // RGB scanlines have the layout of a row of pixels and are decoded in place,
+    // grayscale scanlines are decoded to scratch lines and spread to all components
+    while (decompressInfo.output_scanline < decompressInfo.output_height)
     {
-        m_raw_image[row][col].red = data[dataI];
-        if (components == 1)
+        int first = decompressInfo.output_scanline;
+        int batch = std::min<int>(ROW_BATCH, m_height - first);
+
+        JSAMPROW rows[ROW_BATCH];
+        for (int i = 0; i < batch; ++i)
         {
-            // if jpeg is grayscaled then all color components should be the same
-            m_raw_image[row][col].green = data[dataI];
-            m_raw_image[row][col].blue = data[dataI];
+            rows[i] = components == 1 ? greyLine.data() + i * m_width : reinterpret_cast<unsigned char *>(decodeRow(first + i));
         }
-        else
+
+        int count = 0;
+        while (count < batch)
         {
-            m_raw_image[row][col].green = data[dataI + 1];
-            m_raw_image[row][col].blue = data[dataI + 2];
+            count += jpeg_read_scanlines(&decompressInfo, rows + count, batch - count);
         }
-        if (++col >= static_cast<size_t>(m_width))
+
+        if (components == 1)
         {
-            col = 0;
-            ++row;
+            for (int i = 0; i < count; ++i)
+            {
+                Pixel *row = decodeRow(first + i);
+                for (int x = 0; x < m_width; ++x)
+                {
+                    row[x].red = row[x].green = row[x].blue = rows[i][x];
+                }
+            }
         }
+        finishRows(first, count);
     }
+    endRows();
+
+    jpeg_finish_decompress(&decompressInfo);
+    jpeg_destroy_decompress(&decompressInfo);
 
     return true;
 }
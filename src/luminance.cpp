@@ -0,0 +1,332 @@
+/**
+ * @file luminance.cpp
+ * @brief Implementation of the Luminance tables and row kernels.
+ */
+
+#include "luminance.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LUMINANCE_X86 1
+#endif
+
+namespace
+{
+    const double WEIGHTS[3] = {0.2126, 0.7152, 0.0722};
+
+    /**
+     * @brief Convert a gamma-compressed channel value to its linear component.
+     * @param value The channel value.
+     * @return The linear component in the range [0, 1].
+     */
+    double linearComponent(unsigned char value)
+    {
+        double gammaCompressed = value / 255.0;
+        return (gammaCompressed <= 0.04045) ? gammaCompressed / 12.92 : pow((gammaCompressed + 0.055) / 1.055, 2.4);
+    }
+
+    /**
+     * @brief Convert linear luminance to the gamma-compressed grey value.
+     * @param linearLuminance The linear luminance, at most slightly above 1.
+     * @return The grey value in the range [0, 255].
+     */
+    unsigned char compressLuminance(double linearLuminance)
+    {
+        double gammaCompressedLuminance = (linearLuminance <= 0.0031308) ? linearLuminance * 12.92 : 1.055 * pow(linearLuminance, 1.0 / 2.4) - 0.055;
+        return static_cast<unsigned char>(gammaCompressedLuminance * 255.0);
+    }
+
+    double fromBits(uint64_t bits)
+    {
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint64_t toBits(double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    /**
+     * @brief Find the smallest linear luminance which is compressed to at least the given grey value.
+     * @param grey The grey value.
+     * @param upper The largest linear luminance the tables can see.
+     * @return The threshold, or +inf if the grey value is never reached.
+     *
+     * Non-negative doubles are ordered like their bit patterns, so a binary search over
+     * the bit patterns finds the exact boundary of the original formula.
+     */
+    double findThreshold(int grey, double upper)
+    {
+        uint64_t low = 0, high = toBits(upper);
+        if (compressLuminance(upper) < grey)
+            return std::numeric_limits<double>::infinity();
+
+        while (low < high)
+        {
+            uint64_t middle = low + (high - low) / 2;
+            if (compressLuminance(fromBits(middle)) >= grey)
+                high = middle;
+            else
+                low = middle + 1;
+        }
+        return fromBits(low);
+    }
+
+    Luminance::Tables buildTables()
+    {
+        Luminance::Tables tables;
+
+        for (int channel = 0; channel < 3; ++channel)
+            for (int value = 0; value < 256; ++value)
+                tables.weighted[channel][value] = linearComponent(value) * WEIGHTS[channel];
+
+        // The sum of the weights rounds to 1.0 or just above it, the inverse table covers one more interval
+        double upper = static_cast<double>(Luminance::INVERSE_SIZE - 1) / (1 << Luminance::INVERSE_BITS);
+        for (int i = 0; i < Luminance::INVERSE_SIZE; ++i)
+            tables.inverse[i] = compressLuminance(static_cast<double>(i) / (1 << Luminance::INVERSE_BITS));
+
+        tables.thresholds[0] = 0.0;
+        for (int grey = 1; grey < 256; ++grey)
+            tables.thresholds[grey] = findThreshold(grey, upper);
+        tables.thresholds[256] = std::numeric_limits<double>::infinity();
+
+        return tables;
+    }
+
+    /**
+     * @brief Convert linear luminance to the grey value using the tables.
+     *
+     * The inverse table gives the grey value at the start of the fixed-point interval.
+     * The steepest slope of the sRGB curve is below 3300 grey values per unit, so one
+     * interval of 1/4096 crosses at most one threshold and one correction step is exact.
+     */
+    inline unsigned char lookupGrey(const Luminance::Tables &tables, double linearLuminance)
+    {
+        int grey = tables.inverse[static_cast<int>(linearLuminance * (1 << Luminance::INVERSE_BITS))];
+        grey += linearLuminance >= tables.thresholds[grey + 1];
+        return static_cast<unsigned char>(grey);
+    }
+
+    void convertRowScalar(const unsigned char *rgb, unsigned char *grey, size_t count)
+    {
+        const Luminance::Tables &tables = Luminance::tables();
+        for (size_t i = 0; i < count; ++i, rgb += 3)
+        {
+            double linearLuminance = tables.weighted[0][rgb[0]] + tables.weighted[1][rgb[1]] + tables.weighted[2][rgb[2]];
+            grey[i] = lookupGrey(tables, linearLuminance);
+        }
+    }
+
+#ifdef LUMINANCE_X86
+    /**
+     * @brief AVX2 kernel, 4 pixels per step with table gathers.
+     */
+    __attribute__((target("avx2"))) void convertRowAvx2(const unsigned char *rgb, unsigned char *grey, size_t count)
+    {
+        const Luminance::Tables &tables = Luminance::tables();
+        const __m256d scale = _mm256_set1_pd(1 << Luminance::INVERSE_BITS);
+        // spread the red, green and blue bytes of 4 pixels to 32-bit lanes
+        const __m128i redMask = _mm_setr_epi8(0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1);
+        const __m128i greenMask = _mm_setr_epi8(1, -1, -1, -1, 4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1);
+        const __m128i blueMask = _mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+        const __m256i lowHalves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+        size_t i = 0;
+        // a 16 byte load of 4 pixels reads 4 bytes past them, so stop while 2 more pixels remain
+        for (; i + 6 <= count; i += 4)
+        {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgb + 3 * i));
+            __m128i red = _mm_shuffle_epi8(pixels, redMask);
+            __m128i green = _mm_shuffle_epi8(pixels, greenMask);
+            __m128i blue = _mm_shuffle_epi8(pixels, blueMask);
+
+            __m256d linearLuminance = _mm256_add_pd(_mm256_add_pd(_mm256_i32gather_pd(tables.weighted[0], red, 8),
+                                                                  _mm256_i32gather_pd(tables.weighted[1], green, 8)),
+                                                    _mm256_i32gather_pd(tables.weighted[2], blue, 8));
+
+            __m128i index = _mm256_cvttpd_epi32(_mm256_mul_pd(linearLuminance, scale));
+            __m128i value = _mm_i32gather_epi32(tables.inverse, index, 4);
+            __m256d next = _mm256_i32gather_pd(tables.thresholds + 1, value, 8);
+            __m256d reached = _mm256_cmp_pd(linearLuminance, next, _CMP_GE_OQ);
+            // the comparison gives all ones (-1) per lane, subtracting it adds the correction step
+            __m128i correction = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(reached), lowHalves));
+            value = _mm_sub_epi32(value, correction);
+
+            __m128i packed = _mm_packus_epi16(_mm_packus_epi32(value, value), value);
+            int32_t four = _mm_cvtsi128_si32(packed);
+            memcpy(grey + i, &four, sizeof(four));
+        }
+        convertRowScalar(rgb + 3 * i, grey + i, count - i);
+    }
+
+    /**
+     * @brief SSE4.1 kernel, 2 pixels per step.
+     *
+     * Without gathers the table loads stay scalar, the luminance sum, the fixed-point
+     * index and the threshold correction are done for both pixels at once.
+     */
+    __attribute__((target("sse4.1"))) void convertRowSse41(const unsigned char *rgb, unsigned char *grey, size_t count)
+    {
+        const Luminance::Tables &tables = Luminance::tables();
+        const __m128d scale = _mm_set1_pd(1 << Luminance::INVERSE_BITS);
+
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            const unsigned char *p = rgb + 3 * i;
+            __m128d linearLuminance = _mm_add_pd(_mm_add_pd(_mm_setr_pd(tables.weighted[0][p[0]], tables.weighted[0][p[3]]),
+                                                            _mm_setr_pd(tables.weighted[1][p[1]], tables.weighted[1][p[4]])),
+                                                 _mm_setr_pd(tables.weighted[2][p[2]], tables.weighted[2][p[5]]));
+
+            __m128i index = _mm_cvttpd_epi32(_mm_mul_pd(linearLuminance, scale));
+            int first = tables.inverse[_mm_cvtsi128_si32(index)];
+            int second = tables.inverse[_mm_extract_epi32(index, 1)];
+
+            __m128d next = _mm_setr_pd(tables.thresholds[first + 1], tables.thresholds[second + 1]);
+            int reached = _mm_movemask_pd(_mm_cmpge_pd(linearLuminance, next));
+
+            grey[i] = static_cast<unsigned char>(first + (reached & 1));
+            grey[i + 1] = static_cast<unsigned char>(second + (reached >> 1));
+        }
+        convertRowScalar(rgb + 3 * i, grey + i, count - i);
+    }
+#endif
+
+    typedef void (*RowKernel)(const unsigned char *, unsigned char *, size_t);
+
+    struct Kernel
+    {
+        RowKernel function;
+        const char *name;
+    };
+
+    /**
+     * @brief Measure how long a kernel takes to convert a synthetic row.
+     * @return The best time of a few runs in nanoseconds.
+     */
+    long long measureKernel(RowKernel function)
+    {
+        const size_t count = 4096;
+        static unsigned char rgb[3 * count], grey[count];
+        for (size_t i = 0; i < 3 * count; ++i)
+            rgb[i] = static_cast<unsigned char>(i * 97 + (i >> 5));
+
+        long long best = std::numeric_limits<long long>::max();
+        for (int run = 0; run < 5; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            function(rgb, grey, count);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min<long long>(best, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+        return best;
+    }
+
+    /**
+     * @brief Get the kernels the CPU supports, the scalar one first.
+     */
+    const std::vector<Kernel> &supportedKernels()
+    {
+        static const std::vector<Kernel> supported = []
+        {
+            std::vector<Kernel> candidates = {{convertRowScalar, "scalar"}};
+#ifdef LUMINANCE_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("sse4.1"))
+                candidates.push_back({convertRowSse41, "sse4.1"});
+            if (__builtin_cpu_supports("avx2"))
+                candidates.push_back({convertRowAvx2, "avx2"});
+#endif
+            return candidates;
+        }();
+        return supported;
+    }
+
+    /**
+     * @brief Select the row kernel.
+     *
+     * Of the kernels the CPU supports, the fastest one on a short calibration row wins.
+     * Gathers are fast on some CPUs and microcoded on others, so the SIMD kernels are
+     * not always faster than the scalar one. All of them give the same output.
+     */
+    Kernel selectKernel()
+    {
+        const std::vector<Kernel> &candidates = supportedKernels();
+        Kernel selected = candidates.front();
+        long long bestTime = measureKernel(selected.function);
+        for (size_t i = 1; i < candidates.size(); ++i)
+        {
+            long long time = measureKernel(candidates[i].function);
+            // prefer the vector kernel unless it is clearly slower
+            if (time * 20 <= bestTime * 21)
+            {
+                selected = candidates[i];
+                bestTime = std::min(bestTime, time);
+            }
+        }
+        return selected;
+    }
+
+    const Kernel &kernel()
+    {
+        static const Kernel selected = selectKernel();
+        return selected;
+    }
+}
+
+const Luminance::Tables &Luminance::tables()
+{
+    static const Tables built = buildTables();
+    return built;
+}
+
+unsigned char Luminance::greyOf(unsigned char red, unsigned char green, unsigned char blue)
+{
+    const Tables &t = tables();
+    return lookupGrey(t, t.weighted[0][red] + t.weighted[1][green] + t.weighted[2][blue]);
+}
+
+void Luminance::convertRow(const unsigned char *rgb, unsigned char *grey, size_t count)
+{
+    kernel().function(rgb, grey, count);
+}
+
+unsigned char Luminance::referenceGrey(unsigned char red, unsigned char green, unsigned char blue)
+{
+    // get basic linear luminance
+    double linearLuminance = linearComponent(red) * WEIGHTS[0] + linearComponent(green) * WEIGHTS[1] + linearComponent(blue) * WEIGHTS[2];
+
+    // convert to gamma compressed luminance
+    return compressLuminance(linearLuminance);
+}
+
+const char *Luminance::kernelName()
+{
+    return kernel().name;
+}
+
+int Luminance::kernelCount()
+{
+    return static_cast<int>(supportedKernels().size());
+}
+
+const char *Luminance::kernelName(int index)
+{
+    return supportedKernels()[index].name;
+}
+
+void Luminance::convertRowWith(int index, const unsigned char *rgb, unsigned char *grey, size_t count)
+{
+    supportedKernels()[index].function(rgb, grey, count);
+}
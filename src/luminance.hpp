@@ -0,0 +1,101 @@
+#ifndef LUMINANCE_H
+#define LUMINANCE_H
+
+#include <cstddef>
+
+/**
+ * @class Luminance
+ * @brief Table-driven conversion of sRGB pixels to gamma-compressed luminance.
+ *
+ * The conversion gives the same result as the original per-pixel formula
+ * (sRGB -> linear, Rec. 709 weights, linear -> sRGB), bit for bit, but without
+ * calling pow() for every pixel. The forward direction is a 256-entry table per
+ * channel, the inverse direction is a fixed-point table with one exact threshold
+ * correction. Rows are converted with an AVX2 or SSE4.1 kernel when the CPU
+ * supports it, otherwise with the scalar code.
+ */
+class Luminance
+{
+public:
+    /**
+     * @brief Get the grey value of one pixel.
+     * @param red The red color component.
+     * @param green The green color component.
+     * @param blue The blue color component.
+     * @return The gamma-compressed luminance in the range [0, 255].
+     */
+    static unsigned char greyOf(unsigned char red, unsigned char green, unsigned char blue);
+
+    /**
+     * @brief Convert a row of interleaved RGB pixels to grey values.
+     * @param rgb The pixels, 3 bytes (red, green, blue) per pixel.
+     * @param grey The output buffer, one byte per pixel.
+     * @param count The number of pixels to convert.
+     */
+    static void convertRow(const unsigned char *rgb, unsigned char *grey, size_t count);
+
+    /**
+     * @brief Get the grey value of one pixel using the pow() based formula.
+     * @param red The red color component.
+     * @param green The green color component.
+     * @param blue The blue color component.
+     * @return The gamma-compressed luminance in the range [0, 255].
+     *
+     * This is the reference the tables are built from. It is slow and should only be used to verify them.
+     */
+    static unsigned char referenceGrey(unsigned char red, unsigned char green, unsigned char blue);
+
+    /**
+     * @brief Get the name of the kernel used by convertRow.
+     * @return "avx2", "sse4.1" or "scalar".
+     */
+    static const char *kernelName();
+
+    /**
+     * @brief Get the number of row kernels the CPU supports.
+     * @return At least 1, the scalar kernel is always supported.
+     */
+    static int kernelCount();
+
+    /**
+     * @brief Get the name of a supported row kernel.
+     * @param index The index of the kernel, 0 to kernelCount() - 1. Kernel 0 is the scalar one.
+     * @return "scalar", "sse4.1" or "avx2".
+     */
+    static const char *kernelName(int index);
+
+    /**
+     * @brief Convert a row with one particular kernel instead of the selected one.
+     * @param index The index of the kernel, 0 to kernelCount() - 1.
+     * @param rgb The pixels, 3 bytes (red, green, blue) per pixel.
+     * @param grey The output buffer, one byte per pixel.
+     * @param count The number of pixels to convert.
+     *
+     * All kernels give the same output, this lets a test check every one of them.
+     */
+    static void convertRowWith(int index, const unsigned char *rgb, unsigned char *grey, size_t count);
+
+    /** Number of fractional bits of the fixed-point index into the inverse table. */
+    static constexpr int INVERSE_BITS = 12;
+    /** Number of entries of the inverse table (one extra for linear luminance rounded up to 1.0). */
+    static constexpr int INVERSE_SIZE = (1 << INVERSE_BITS) + 2;
+
+    /**
+     * @struct Tables
+     * @brief The precomputed conversion tables.
+     */
+    struct Tables
+    {
+        double weighted[3][256];  /**< The linear component of each channel value multiplied by its weight. */
+        int inverse[INVERSE_SIZE]; /**< The grey value at the start of each fixed-point interval of linear luminance. */
+        double thresholds[257];    /**< The smallest linear luminance which gives each grey value, +inf at the end. */
+    };
+
+    /**
+     * @brief Get the conversion tables.
+     * @return The tables, built on the first call.
+     */
+    static const Tables &tables();
+};
+
+#endif
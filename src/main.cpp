@@ -11,14 +11,29 @@
 #include <string>
 #include <iomanip>
 #include <unistd.h>
+#include "terminal.hpp"
+#include "threadpool.hpp"
 #include "utils.hpp"
 
 /**
  * @brief Main function of the image processing program.
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
  * @return The exit status of the program.
  */
-int main()
+int main(int argc, char *argv[])
 {
+    if (!parseArguments(argc, argv))
+    {
+        return 1;
+    }
+
+    // The ASCII images are re-rendered after the terminal is resized
+    Terminal::installResizeHandler();
+
+    // The worker threads are started once and shared by all images
+    ThreadPool::shared().setThreadCount(settings().threads);
+
     if (!welcomeUser())
     {
         return 0;
@@ -0,0 +1,93 @@
+/**
+ * @file terminal.cpp
+ * @brief Implementation of the Terminal class.
+ */
+
+#include "terminal.hpp"
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <iostream>
+#include <mutex>
+
+namespace
+{
+    std::atomic<unsigned> generation{1};
+    std::atomic<bool> installed{false};
+
+    static_assert(std::atomic<unsigned>::is_always_lock_free, "the signal handler needs a lock-free counter");
+
+    void onResize(int)
+    {
+        generation.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Terminal::installResizeHandler()
+{
+    if (installed.exchange(true))
+        return;
+
+    struct sigaction action = {};
+    action.sa_handler = onResize;
+    sigemptyset(&action.sa_mask);
+    // do not interrupt reads from std::cin
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGWINCH, &action, nullptr);
+}
+
+unsigned Terminal::resizeGeneration()
+{
+    return generation.load(std::memory_order_relaxed);
+}
+
+bool Terminal::getSize(int &columns, int &rows)
+{
+    static unsigned cachedGeneration = 0;
+    static int cachedColumns = 80, cachedRows = 24;
+    static bool cachedValid = false;
+    // images loaded in parallel all ask for the size
+    static std::mutex mutex;
+
+    installResizeHandler();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    unsigned current = resizeGeneration();
+    if (current != cachedGeneration)
+    {
+        cachedGeneration = current;
+
+        struct winsize w = {};
+        cachedValid = ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_col && w.ws_row;
+        cachedColumns = cachedValid ? w.ws_col : 80;
+        cachedRows = cachedValid ? w.ws_row : 24;
+    }
+
+    columns = cachedColumns;
+    rows = cachedRows;
+    return cachedValid;
+}
+
+bool Terminal::write(const std::string &frame)
+{
+    // text printed through the stream before the frame has to stay before it
+    std::cout.flush();
+
+    const char *data = frame.data();
+    size_t left = frame.size();
+    while (left > 0)
+    {
+        ssize_t written = ::write(STDOUT_FILENO, data, left);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        left -= static_cast<size_t>(written);
+    }
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include <string>
+
+/**
+ * @class Terminal
+ * @brief The size of the terminal, tracked through SIGWINCH, and the output of whole frames.
+ *
+ * The size is read with ioctl(TIOCGWINSZ) only after the terminal reports a resize,
+ * every other query returns the cached value.
+ */
+class Terminal
+{
+public:
+    /**
+     * @brief Install the SIGWINCH handler.
+     *
+     * Called once at startup, getSize installs it on first use otherwise.
+     */
+    static void installResizeHandler();
+
+    /**
+     * @brief Get the number of resizes seen so far.
+     * @return The resize generation, it changes whenever the terminal is resized.
+     */
+    static unsigned resizeGeneration();
+
+    /**
+     * @brief Get the size of the terminal.
+     * @param columns The number of columns.
+     * @param rows The number of rows.
+     * @return True if the size was read from the terminal, false if the default 80x24 is used.
+     *
+     * Safe to call from several threads.
+     */
+    static bool getSize(int &columns, int &rows);
+
+    /**
+     * @brief Write a frame to the standard output.
+     * @param frame The bytes of the frame.
+     * @return True if all bytes were written, false on an error.
+     *
+     * std::cout is flushed first, then the frame goes out with one write(2), more only when the
+     * terminal takes a part of it. The terminal so never shows half of a frame built by us.
+     */
+    static bool write(const std::string &frame);
+};
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file terminalscreen.cpp
+ * @brief Implementation of the TerminalScreen class.
+ */
+
+#include "terminalscreen.hpp"
+#include "ansicolor.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+    // the clear and home sequence which starts a repaint
+    const char REPAINT[] = "\033[2J\033[1;1H";
+
+    int digits(int number)
+    {
+        int count = 1;
+        while (number >= 10)
+        {
+            number /= 10;
+            ++count;
+        }
+        return count;
+    }
+
+    // the length of the cursor move to a cell, rows and columns from 0
+    int moveCost(int x, int y)
+    {
+        return 4 + digits(y + 1) + digits(x + 1);
+    }
+
+    void moveCursor(std::string &frame, int x, int y)
+    {
+        char buffer[32];
+        int length = snprintf(buffer, sizeof(buffer), "\033[%d;%dH", y + 1, x + 1);
+        frame.append(buffer, length);
+    }
+}
+
+void TerminalScreen::invalidate()
+{
+    m_valid = false;
+}
+
+void TerminalScreen::renderFull(Buffer2DView<const char> glyphs, Buffer2DView<const uint32_t> colors, const CellEncoding &encoding,
+                                std::string &frame, bool newlines)
+{
+    frame.assign(REPAINT);
+    frame.reserve(frame.size() + static_cast<size_t>(glyphs.width() * encoding.maxBytes() + 1) * glyphs.height());
+    uint32_t current = AnsiColor::DEFAULT;
+    for (int y = 0; y < glyphs.height(); ++y)
+    {
+        if (y > 0 && !newlines)
+            frame.push_back('\n');
+        AnsiColor::appendRow(glyphs.row(y), colors.empty() ? nullptr : colors.row(y), glyphs.width(), encoding, current, frame);
+        if (newlines)
+            frame.push_back('\n');
+    }
+    AnsiColor::appendDefault(current, frame);
+}
+
+bool TerminalScreen::render(Buffer2DView<const char> glyphs, Buffer2DView<const uint32_t> colors, const CellEncoding &encoding,
+                            std::string &update, std::string &full)
+{
+    const int width = glyphs.width(), height = glyphs.height();
+    renderFull(glyphs, colors, encoding, full);
+    update.clear();
+    bool repaint = !m_valid || m_shown.width() != width || m_shown.height() != height || m_shown_colors.empty() != colors.empty();
+
+    if (!repaint)
+    {
+        uint32_t current = AnsiColor::DEFAULT;
+        for (int y = 0; y < height && update.size() < full.size(); ++y)
+        {
+            const char *now = glyphs.row(y);
+            const char *before = m_shown.row(y);
+            const uint32_t *nowColors = colors.empty() ? nullptr : colors.row(y);
+            const uint32_t *beforeColors = colors.empty() ? nullptr : m_shown_colors.row(y);
+            auto same = [&](int x)
+            {
+                return now[x] == before[x] && (!nowColors || encoding.isBlank(now[x]) || nowColors[x] == beforeColors[x]);
+            };
+
+            int x = 0;
+            while (true)
+            {
+                while (x < width && same(x))
+                {
+                    ++x;
+                }
+                if (x == width)
+                    break;
+
+                // take the changed cells and the equal gaps shorter than a new cursor move
+                const int first = x;
+                int last = x;
+                while (x < width)
+                {
+                    if (!same(x))
+                    {
+                        last = ++x;
+                        continue;
+                    }
+                    int gap = x;
+                    while (gap < width && same(gap))
+                    {
+                        ++gap;
+                    }
+                    if (gap == width || gap - x >= moveCost(gap, y))
+                        break;
+                    x = gap;
+                }
+
+                moveCursor(update, first, y);
+                AnsiColor::appendRow(now + first, nowColors ? nowColors + first : nullptr, last - first, encoding, current, update);
+                x = last;
+            }
+        }
+
+        // leave the cursor and the color where a repaint leaves them
+        if (!update.empty())
+        {
+            AnsiColor::appendDefault(current, update);
+            moveCursor(update, width, height - 1);
+        }
+        repaint = update.size() >= full.size();
+    }
+
+    if (repaint)
+        update.clear();
+
+    m_shown.resize(width, height);
+    for (int y = 0; y < height; ++y)
+    {
+        std::copy(glyphs.row(y), glyphs.row(y) + width, m_shown.row(y));
+    }
+    if (colors.empty())
+    {
+        m_shown_colors.clear();
+    }
+    else
+    {
+        m_shown_colors.resize(width, height);
+        for (int y = 0; y < height; ++y)
+        {
+            std::copy(colors.row(y), colors.row(y) + width, m_shown_colors.row(y));
+        }
+    }
+    m_valid = true;
+    return repaint;
+}
@@ -0,0 +1,63 @@
+#ifndef TERMINALSCREEN_H
+#define TERMINALSCREEN_H
+
+#include "buffer2d.hpp"
+#include "cellencoding.hpp"
+#include <cstdint>
+#include <string>
+
+/**
+ * @class TerminalScreen
+ * @brief A model of the glyphs on the screen, for updating only the cells which change.
+ *
+ * The screen keeps a copy of the last rendered grid and its colors. The next grid is compared with
+ * it row by row and only the changed spans are written, each after a cursor move. A cell changes
+ * when its glyph does, or its color unless the glyph is blank. Spans separated by fewer equal
+ * cells than a cursor move costs are joined. When the update would not be smaller than repainting,
+ * or the size changed, the whole screen is repainted instead.
+ *
+ * The grid is drawn from the top left corner without a newline after the last row, so a grid as
+ * high as the terminal does not scroll, and every frame leaves the cursor after the last row
+ * with the default color.
+ */
+class TerminalScreen
+{
+    Buffer2D<char> m_shown;            /**< The grid on the screen. */
+    Buffer2D<uint32_t> m_shown_colors; /**< The colors on the screen, empty without colors. */
+    bool m_valid = false;              /**< Whether m_shown is what the screen shows. */
+
+public:
+    /**
+     * @brief Forget the screen content, the next frame repaints everything.
+     */
+    void invalidate();
+
+    /**
+     * @brief Render the bytes which change the screen to a grid.
+     * @param glyphs The new grid.
+     * @param colors The AnsiColor code of every glyph, an empty view without colors.
+     * @param encoding The encoding of the glyphs, the same for all frames.
+     * @param update The string to fill with the changed cells, its capacity is reused.
+     * @param full The string to fill with the repaint, its capacity is reused.
+     * @return True if the screen has to be repainted, update is then empty.
+     *
+     * The repaint is always rendered, so that it can be written when the screen does not show the
+     * previous grid after all.
+     */
+    bool render(Buffer2DView<const char> glyphs, Buffer2DView<const uint32_t> colors, const CellEncoding &encoding,
+                std::string &update, std::string &full);
+
+    /**
+     * @brief Render the bytes which repaint the whole screen with a grid.
+     * @param glyphs The grid.
+     * @param colors The AnsiColor code of every glyph, an empty view without colors.
+     * @param encoding The encoding of the glyphs.
+     * @param frame The string to fill, its capacity is reused.
+     * @param newlines True to end every row with a newline, for a grid followed by other output.
+     *                 Without them the last row ends the frame, so the grid does not scroll.
+     */
+    static void renderFull(Buffer2DView<const char> glyphs, Buffer2DView<const uint32_t> colors, const CellEncoding &encoding,
+                           std::string &frame, bool newlines = false);
+};
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file threadpool.cpp
+ * @brief Implementation of the ThreadPool class.
+ */
+
+#include "threadpool.hpp"
+#include <algorithm>
+
+namespace
+{
+    // whether the current thread works on a band, nested loops then run inline
+    thread_local bool insideBand = false;
+}
+
+ThreadPool::ThreadPool() {}
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::setThreadCount(unsigned count)
+{
+    if (count == 0)
+        count = std::max(1u, std::thread::hardware_concurrency());
+
+    std::lock_guard<std::mutex> job(m_job_mutex);
+    stop();
+    m_stop = false;
+    for (unsigned i = 1; i < count; ++i)
+    {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+unsigned ThreadPool::threadCount() const
+{
+    return static_cast<unsigned>(m_workers.size()) + 1;
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+void ThreadPool::runBands(const std::function<void(int, int)> &body, int count, int bands)
+{
+    insideBand = true;
+    int band;
+    while ((band = m_next.fetch_add(1)) < bands)
+    {
+        // the same split for the same count and number of bands
+        int first = static_cast<int>(static_cast<long long>(count) * band / bands);
+        int last = static_cast<int>(static_cast<long long>(count) * (band + 1) / bands);
+        body(first, last);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_remaining == 0)
+            m_done.notify_one();
+    }
+    insideBand = false;
+}
+
+void ThreadPool::workerLoop()
+{
+    unsigned seen = 0;
+    while (true)
+    {
+        const std::function<void(int, int)> *body;
+        int count, bands;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_job != seen; });
+            if (m_stop)
+                return;
+            seen = m_job;
+            // a worker waking after the job ended sees no bands
+            body = m_body;
+            count = m_count;
+            bands = m_bands;
+            ++m_busy;
+        }
+        if (bands > 0)
+            runBands(*body, count, bands);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy == 0)
+            m_done.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(int count, int grain, const std::function<void(int first, int last)> &body)
+{
+    if (count <= 0)
+        return;
+
+    grain = std::max(grain, 1);
+    run(count, static_cast<int>(std::min<long long>(threadCount(), (static_cast<long long>(count) + grain - 1) / grain)), body);
+}
+
+void ThreadPool::forEach(int count, const std::function<void(int index)> &body)
+{
+    if (count <= 0)
+        return;
+
+    run(count, threadCount() > 1 ? count : 1, [&body](int first, int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            body(i);
+        }
+    });
+}
+
+void ThreadPool::run(int count, int bands, const std::function<void(int, int)> &body)
+{
+    std::unique_lock<std::mutex> job(m_job_mutex, std::defer_lock);
+    if (bands <= 1 || insideBand || !job.try_lock())
+    {
+        body(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_body = &body;
+        m_count = count;
+        m_bands = bands;
+        m_next = 0;
+        m_remaining = bands;
+        ++m_job;
+    }
+    m_wake.notify_all();
+
+    runBands(body, count, bands);
+
+    // the body must outlive every worker which took it
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_remaining == 0 && m_busy == 0; });
+    m_body = nullptr;
+    m_bands = 0;
+}
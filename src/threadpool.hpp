@@ -0,0 +1,122 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief The worker threads shared by all pixel stages.
+ *
+ * A stage splits its rows into bands with parallelFor, the calling thread works on bands too.
+ * Every row is computed the same way whatever band it falls in, so the output does not depend
+ * on the number of threads.
+ */
+class ThreadPool
+{
+    std::vector<std::thread> m_workers;  /**< The worker threads, one less than the thread count. */
+    std::mutex m_job_mutex;              /**< Held while a job runs, jobs do not overlap. */
+    std::mutex m_mutex;                  /**< Guards the job fields below. */
+    std::condition_variable m_wake;      /**< Signals a new job or stop to the workers. */
+    std::condition_variable m_done;      /**< Signals the end of the last band to the caller. */
+    const std::function<void(int, int)> *m_body = nullptr; /**< The work of the current job. */
+    int m_count = 0;                     /**< The number of rows of the current job. */
+    int m_bands = 0;                     /**< The number of bands of the current job. */
+    std::atomic<int> m_next{0};          /**< The next band to claim. */
+    int m_remaining = 0;                 /**< The number of bands not finished yet. */
+    int m_busy = 0;                      /**< The number of workers which took the current job. */
+    unsigned m_job = 0;                  /**< Incremented for every job. */
+    bool m_stop = false;                 /**< Whether the workers have to exit. */
+
+    ThreadPool();
+
+    /**
+     * @brief Run a job.
+     * @param count The number of rows.
+     * @param bands The number of bands to split the rows into.
+     * @param body The work for the rows [first, last), called once per band.
+     */
+    void run(int count, int bands, const std::function<void(int, int)> &body);
+
+    /**
+     * @brief Work on bands of the current job until none is left.
+     * @param body The work of the job.
+     * @param count The number of rows of the job.
+     * @param bands The number of bands of the job.
+     */
+    void runBands(const std::function<void(int, int)> &body, int count, int bands);
+
+    /**
+     * @brief The loop of a worker thread.
+     */
+    void workerLoop();
+
+    /**
+     * @brief Stop and join the worker threads.
+     */
+    void stop();
+
+public:
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    /**
+     * @brief Get the pool shared by the program.
+     * @return The pool, without worker threads until setThreadCount is called.
+     */
+    static ThreadPool &shared();
+
+    /**
+     * @brief Set the number of threads working on a job.
+     * @param count The number of threads including the calling one, 0 for the number of hardware threads.
+     */
+    void setThreadCount(unsigned count);
+
+    /**
+     * @brief Get the number of threads working on a job.
+     * @return The number of threads including the calling one.
+     */
+    unsigned threadCount() const;
+
+    /** The smallest number of pixels worth a band of their own. */
+    static constexpr long long GRAIN_PIXELS = 1 << 16;
+
+    /**
+     * @brief Get the grain of a loop over rows.
+     * @param pixelsPerRow The number of pixels a row of the loop works on.
+     * @return The smallest number of rows worth a band, see parallelFor.
+     */
+    static int grainFor(long long pixelsPerRow)
+    {
+        return static_cast<int>(std::max(1LL, GRAIN_PIXELS / std::max(1LL, pixelsPerRow)));
+    }
+
+    /**
+     * @brief Run a loop over rows in bands.
+     * @param count The number of rows.
+     * @param grain The smallest number of rows worth a band of its own.
+     * @param body The work for the rows [first, last), called once per band.
+     *
+     * Returns when all bands are done. A call from inside a band, or while another thread
+     * runs a job, runs all rows on the calling thread.
+     */
+    void parallelFor(int count, int grain, const std::function<void(int first, int last)> &body);
+
+    /**
+     * @brief Run a loop over independent items.
+     * @param count The number of items.
+     * @param body The work for one item.
+     *
+     * Every item is claimed on its own, so a few slow items do not hold up the others.
+     * Loops over rows inside an item run on the thread of the item.
+     */
+    void forEach(int count, const std::function<void(int index)> &body);
+};
+
+#endif
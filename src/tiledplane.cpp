@@ -0,0 +1,92 @@
+/**
+ * @file tiledplane.cpp
+ * @brief Implementation of the TiledPlane class.
+ */
+
+#include "tiledplane.hpp"
+#include <algorithm>
+#include <cstring>
+
+size_t TiledPlane::capture(Buffer2DView<const unsigned char> plane, const TiledPlane *previous)
+{
+    const int columns = (plane.width() + TILE_SIZE - 1) / TILE_SIZE;
+    const int rows = (plane.height() + TILE_SIZE - 1) / TILE_SIZE;
+    // tiles are only shared between planes of the same size
+    if (previous && (previous->m_width != plane.width() || previous->m_height != plane.height()))
+        previous = nullptr;
+
+    std::vector<std::shared_ptr<const Tile>> tiles(static_cast<size_t>(columns) * rows);
+    size_t copied = 0;
+    for (int tileY = 0; tileY < rows; ++tileY)
+    {
+        for (int tileX = 0; tileX < columns; ++tileX)
+        {
+            const int left = tileX * TILE_SIZE, top = tileY * TILE_SIZE;
+            const int width = std::min(TILE_SIZE, plane.width() - left);
+            const int height = std::min(TILE_SIZE, plane.height() - top);
+            const size_t index = static_cast<size_t>(tileY) * columns + tileX;
+
+            // compare with the earlier tile in place, so shared tiles are never copied
+            bool same = previous != nullptr;
+            for (int y = 0; y < height && same; ++y)
+            {
+                same = memcmp(previous->m_tiles[index]->pixels + y * TILE_SIZE, plane.row(top + y) + left, width) == 0;
+            }
+            if (same)
+            {
+                tiles[index] = previous->m_tiles[index];
+                continue;
+            }
+
+            std::shared_ptr<Tile> tile(new Tile);
+            if (width < TILE_SIZE || height < TILE_SIZE)
+                memset(tile->pixels, 0, TILE_BYTES);
+            for (int y = 0; y < height; ++y)
+            {
+                memcpy(tile->pixels + y * TILE_SIZE, plane.row(top + y) + left, width);
+            }
+            tiles[index] = tile;
+            ++copied;
+        }
+    }
+
+    m_tiles.swap(tiles);
+    m_width = plane.width();
+    m_height = plane.height();
+    m_columns = columns;
+    return copied;
+}
+
+void TiledPlane::restore(Buffer2DView<unsigned char> plane) const
+{
+    const int width = std::min(m_width, plane.width());
+    const int height = std::min(m_height, plane.height());
+    for (int y = 0; y < height; ++y)
+    {
+        unsigned char *row = plane.row(y);
+        const size_t first = static_cast<size_t>(y / TILE_SIZE) * m_columns;
+        const int offset = (y % TILE_SIZE) * TILE_SIZE;
+        for (int left = 0; left < width; left += TILE_SIZE)
+        {
+            memcpy(row + left, m_tiles[first + left / TILE_SIZE]->pixels + offset, std::min(TILE_SIZE, width - left));
+        }
+    }
+}
+
+void TiledPlane::clear()
+{
+    m_tiles.clear();
+    m_tiles.shrink_to_fit();
+    m_width = m_height = m_columns = 0;
+}
+
+size_t TiledPlane::countNewTiles(std::unordered_set<const void *> &seen) const
+{
+    size_t bytes = 0;
+    for (const std::shared_ptr<const Tile> &tile : m_tiles)
+    {
+        if (seen.insert(tile.get()).second)
+            bytes += sizeof(Tile);
+    }
+    return bytes;
+}
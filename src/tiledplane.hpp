@@ -0,0 +1,74 @@
+#ifndef TILEDPLANE_H
+#define TILEDPLANE_H
+
+#include "buffer2d.hpp"
+#include <cstddef>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @class TiledPlane
+ * @brief A read-only copy of a grey plane stored as shared tiles.
+ *
+ * The plane is cut into TILE_SIZE x TILE_SIZE tiles. Tiles are immutable and reference counted,
+ * so copying a TiledPlane copies no pixels, and capturing a plane next to an earlier capture
+ * shares every tile whose content did not change.
+ */
+class TiledPlane
+{
+public:
+    /** The width and height of a tile in pixels. */
+    static constexpr int TILE_SIZE = 64;
+
+    /** The size of a tile in bytes, edge tiles are padded with zeros. */
+    static constexpr size_t TILE_BYTES = TILE_SIZE * TILE_SIZE;
+
+private:
+    /**
+     * @struct Tile
+     * @brief The pixels of one tile, row after row.
+     */
+    struct Tile
+    {
+        unsigned char pixels[TILE_BYTES];
+    };
+
+    std::vector<std::shared_ptr<const Tile>> m_tiles; /**< The tiles, row after row. */
+    int m_width = 0;                                  /**< The width of the plane. */
+    int m_height = 0;                                 /**< The height of the plane. */
+    int m_columns = 0;                                /**< The number of tiles in a row. */
+
+public:
+    /**
+     * @brief Copy a plane into tiles.
+     * @param plane The plane.
+     * @param previous An earlier capture to share unchanged tiles with, or nullptr.
+     * @return The number of tiles which had to be copied.
+     */
+    size_t capture(Buffer2DView<const unsigned char> plane, const TiledPlane *previous);
+
+    /**
+     * @brief Copy the tiles back to a plane.
+     * @param plane The plane, of the captured size.
+     */
+    void restore(Buffer2DView<unsigned char> plane) const;
+
+    /**
+     * @brief Release the tiles.
+     */
+    void clear();
+
+    bool empty() const { return m_tiles.empty(); }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    /**
+     * @brief Count the memory of the tiles not counted yet.
+     * @param seen The tiles counted so far, the tiles of this plane are added.
+     * @return The number of bytes of the tiles which were not in seen.
+     */
+    size_t countNewTiles(std::unordered_set<const void *> &seen) const;
+};
+
+#endif
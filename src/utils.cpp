@@ -5,9 +5,110 @@
 #include <algorithm>
 #include <string>
 #include <iomanip>
-#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <glob.h>
+#include <chrono>
+#include <thread>
+#include "framering.hpp"
+#include "framescheduler.hpp"
+#include "terminal.hpp"
+#include "terminalscreen.hpp"
+#include "threadpool.hpp"
 #include "utils.hpp"
 
+Settings &settings()
+{
+    static Settings instance;
+    return instance;
+}
+
+namespace
+{
+    /**
+     * @brief Parse a non-negative decimal number.
+     * @param text The text.
+     * @param number The parsed number.
+     * @return True if the whole text is a number, false otherwise.
+     */
+    bool parseNumber(const char *text, unsigned long &number)
+    {
+        char *end;
+        errno = 0;
+        number = strtoul(text, &end, 10);
+        return isdigit(static_cast<unsigned char>(*text)) && *end == '\0' && errno == 0;
+    }
+
+    /** The number of animation frames rendered ahead of the one on the screen. */
+    const size_t FRAMES_AHEAD = 4;
+}
+
+bool parseArguments(int argc, char *argv[])
+{
+    unsigned long number;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        if (argument == "--stream")
+        {
+            settings().streaming = true;
+        }
+        else if (argument == "--scaled-decode")
+        {
+            settings().scaledDecode = true;
+        }
+        else if (argument == "--luma")
+        {
+            settings().lumaDecode = true;
+        }
+        else if (argument == "--history-limit" && i + 1 < argc && parseNumber(argv[i + 1], number))
+        {
+            settings().historyLimit = static_cast<size_t>(number) << 20;
+            ++i;
+        }
+        else if (argument == "--threads" && i + 1 < argc && parseNumber(argv[i + 1], number) && number <= 1024)
+        {
+            settings().threads = static_cast<unsigned>(number);
+            ++i;
+        }
+        else if (argument == "--color" && i + 1 < argc && (std::string(argv[i + 1]) == "256" || std::string(argv[i + 1]) == "truecolor"))
+        {
+            settings().color = std::string(argv[i + 1]) == "256" ? AnsiColor::MODE_256 : AnsiColor::MODE_TRUECOLOR;
+            ++i;
+        }
+        else if (argument == "--render" && i + 1 < argc && (std::string(argv[i + 1]) == "ascii" || std::string(argv[i + 1]) == "halfblock" || std::string(argv[i + 1]) == "braille" || std::string(argv[i + 1]) == "shape"))
+        {
+            std::string mode = argv[i + 1];
+            settings().render = mode == "braille"     ? CellEncoding::MODE_BRAILLE
+                                : mode == "halfblock" ? CellEncoding::MODE_HALF_BLOCK
+                                : mode == "shape"     ? CellEncoding::MODE_SHAPE
+                                                      : CellEncoding::MODE_ASCII;
+            ++i;
+        }
+        else if (argument == "--dither" && i + 1 < argc && (std::string(argv[i + 1]) == "none" || std::string(argv[i + 1]) == "ordered" || std::string(argv[i + 1]) == "diffusion"))
+        {
+            std::string mode = argv[i + 1];
+            settings().dither = mode == "ordered" ? Dither::MODE_ORDERED : mode == "diffusion" ? Dither::MODE_DIFFUSION : Dither::MODE_NONE;
+            ++i;
+        }
+        else
+        {
+            std::cout << "Unknown argument: " << argument << std::endl;
+            std::cout << "Usage: " << argv[0] << " [--stream] [--scaled-decode] [--luma] [--history-limit MiB] [--threads N] [--color 256|truecolor] [--render ascii|halfblock|braille|shape] [--dither none|ordered|diffusion]" << std::endl;
+            std::cout << "  --stream         keep only the grey plane of loaded images (about 1 byte per pixel)" << std::endl;
+            std::cout << "  --scaled-decode  decode JPEG images at the terminal size instead of the full size" << std::endl;
+            std::cout << "  --luma           decode JPEG images to luma (Rec. 601) instead of gamma-correct luminance" << std::endl;
+            std::cout << "  --history-limit  memory limit of the undo history of each image in MiB (default 256)" << std::endl;
+            std::cout << "  --threads        number of threads converting images (default: all hardware threads)" << std::endl;
+            std::cout << "  --color          color the glyphs with 256 colors or 24-bit colors (needs the raw image, not with --stream or --luma)" << std::endl;
+            std::cout << "  --render         cells of glyphs by brightness (default), of half blocks with 1 x 2 pixels, of Braille patterns with 2 x 4 pixels or of glyphs by the shape of 4 x 8 pixels" << std::endl;
+            std::cout << "  --dither         dither the glyphs or dots with an 8 x 8 Bayer matrix or with Floyd-Steinberg error diffusion (default none)" << std::endl;
+            return 0;
+        }
+    }
+    return 1;
+}
+
 bool welcomeUser()
 {
     // Clear terminal:
@@ -16,6 +117,11 @@ bool welcomeUser()
     std::cout << "Welcome to the ASCII transformer!" << std::endl;
 
     JpegImage logo;
+    logo.setStreaming(settings().streaming);
+    logo.setLumaDecode(settings().lumaDecode);
+    logo.setColorMode(settings().color);
+    logo.setRenderMode(settings().render);
+    logo.setDitherMode(settings().dither);
     if (!logo.loadImage("examples/logo.jpg"))
     {
         std::cout << "Sorry..." << std::endl;
@@ -23,23 +129,12 @@ bool welcomeUser()
     }
 
     logo.toGreyScale();
-    logo.convertGreyToAscii();
     logo.resizeAsciiImage();
     logo.printAsciiArt();
 
     return 1;
 }
 
-void trimPath(std::string &path)
-{
-    // If there are ' sings in the path, remove them
-    if (path[0] == '\'' && path[path.size() - 1] == '\'')
-    {
-        path.erase(0, 1);
-        path.erase(path.size() - 1, 1);
-    }
-}
-
 void changeTransition(std::unique_ptr<Image> &im)
 {
     int choice = 0;
@@ -82,9 +177,116 @@ void changeTransition(std::unique_ptr<Image> &im)
     } while (choice != 1 && choice != 2 && choice != 3);
 }
 
+void chooseConvolution(std::unique_ptr<Image> &im, bool edges)
+{
+    if (edges)
+    {
+        std::cout << "Choose the edge detector:" << std::endl;
+        std::cout << "1. Sobel" << std::endl;
+        std::cout << "2. Laplacian" << std::endl;
+    }
+    else
+    {
+        std::cout << "Choose the filter:" << std::endl;
+        std::cout << "1. Box blur" << std::endl;
+        std::cout << "2. Gaussian blur" << std::endl;
+        std::cout << "3. Sharpen (unsharp mask)" << std::endl;
+    }
+    std::cout << ">> ";
+    int choice;
+    while (!(std::cin >> choice) || choice < 1 || choice > (edges ? 2 : 3))
+    {
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::cout << "Try again" << std::endl;
+    }
+
+    // the edge detectors can do without blurring first, the blurs need at least one pixel
+    const int smallest = edges ? 0 : 1;
+    std::cout << "Enter the radius in pixels of the image (from " << smallest << " to " << Convolution::MAX_RADIUS << ")"
+              << (edges ? ", the edges are blurred that much first:" : ":") << std::endl;
+    std::cout << ">> ";
+    int radius;
+    while (!(std::cin >> radius) || radius < smallest || radius > Convolution::MAX_RADIUS)
+    {
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::cout << "Try again" << std::endl;
+    }
+
+    static const Convolution::Kind KINDS[] = {Convolution::KIND_BOX_BLUR, Convolution::KIND_GAUSSIAN_BLUR, Convolution::KIND_SHARPEN,
+                                              Convolution::KIND_SOBEL, Convolution::KIND_LAPLACIAN};
+    im->convolveImage(KINDS[(edges ? 3 : 0) + choice - 1], radius);
+}
+
+void chooseContrast(std::unique_ptr<Image> &im)
+{
+    std::cout << "Choose the adjustment:" << std::endl;
+    std::cout << "1. Brightness" << std::endl;
+    std::cout << "2. Auto levels (stretch the histogram)" << std::endl;
+    std::cout << "3. Local equalization (CLAHE)" << std::endl;
+    std::cout << "4. Gamma" << std::endl;
+    std::cout << ">> ";
+    int choice;
+    while (!(std::cin >> choice) || choice < 1 || choice > 4)
+    {
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::cout << "Try again" << std::endl;
+    }
+
+    if (choice == 1)
+    {
+        std::cout << "Enter the brightness change (from -255 to 255):" << std::endl;
+        std::cout << ">> ";
+        int brightness;
+
+        // Ask for brighness until user enter a valid integer
+        while (!(std::cin >> brightness) || brightness < -255 || brightness > 255)
+        {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            std::cout << "Try again" << std::endl;
+        }
+
+        im->changeBrigtness(brightness);
+    }
+    else if (choice == 2)
+    {
+        im->stretchLevels();
+    }
+    else if (choice == 3)
+    {
+        std::cout << "Enter the clip limit (from 1 for the least change to " << Histogram::MAX_CLIP << " for the most contrast):" << std::endl;
+        std::cout << ">> ";
+        int clip;
+        while (!(std::cin >> clip) || clip < 1 || clip > Histogram::MAX_CLIP)
+        {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            std::cout << "Try again" << std::endl;
+        }
+        im->equalizeImage(clip);
+    }
+    else
+    {
+        std::cout << "Enter the gamma (from 0.1 to 10, above 1 brightens, 0 picks it from the histogram):" << std::endl;
+        std::cout << ">> ";
+        double gamma;
+        while (!(std::cin >> gamma) || (gamma != 0 && (gamma < 0.1 || gamma > 10)))
+        {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            std::cout << "Try again" << std::endl;
+        }
+        im->changeGamma(gamma);
+    }
+}
+
 void showPrompt()
 {
-    std::cout << "Write a path to the JPEG/BMP(24 bit) image or drop it here to add to list (Ctrl + C to quit):" << std::endl;
+    std::cout << "Write a path to the JPEG/BMP image or drop it here to add to list (Ctrl + C to quit):" << std::endl;
+    std::cout << "(several paths or a pattern like frames/*.bmp import all of them)" << std::endl;
     std::cout << ">> ";
 }
 
@@ -122,9 +324,13 @@ void showFilterOptions()
     std::cout << "0. No filter" << std::endl;
     std::cout << "1. Negate image" << std::endl;
     std::cout << "2. Mirror image" << std::endl;
-    std::cout << "3. Change brightness" << std::endl;
+    std::cout << "3. Change brightness or contrast" << std::endl;
     std::cout << "4. Change transition string" << std::endl;
     std::cout << "5. Quit to choose another image " << std::endl;
+    std::cout << "6. Undo the last edit" << std::endl;
+    std::cout << "7. Redo the undone edit" << std::endl;
+    std::cout << "8. Blur or sharpen" << std::endl;
+    std::cout << "9. Detect edges" << std::endl;
 }
 
 void animation(std::vector<std::unique_ptr<Image>> &images)
@@ -173,19 +379,103 @@ void animation(std::vector<std::unique_ptr<Image>> &images)
             break;
     }
 
-    // show images in the given order
-    while (loops != 0)
+    // Render the frames on a producer thread, up to FRAMES_AHEAD before the one on the screen.
+    // Every frame holds the changes from the frame before, and a repaint for when that one was not shown:
+    const long long frames = static_cast<long long>(loops) * order.size();
+    FrameRing ring(FRAMES_AHEAD);
+    std::chrono::steady_clock::duration total_render{}, max_render{};
+    std::thread producer([&]
     {
-        std::cout << "looping!" << loops << std::endl;
-        std::cout << "order size: " << order.size() << std::endl;
-        for (size_t i = 0; i < order.size(); ++i)
+        TerminalScreen screen;
+        for (long long frame = 0; frame < frames; ++frame)
         {
-            images[order[i] - 1]->resizeAsciiImage();
-            images[order[i] - 1]->printAsciiArt();
-            usleep(delay * 1000000);
+            FrameRing::Frame *slot;
+            while (!(slot = ring.reserve()))
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            auto start = std::chrono::steady_clock::now();
+            Image &image = *images[order[frame % order.size()] - 1];
+            image.resizeAsciiImage();
+            slot->repaint = screen.render(image.getAsciiArt(), image.getColors(), image.getEncoding(), slot->update, slot->full);
+            auto work = std::chrono::steady_clock::now() - start;
+            total_render += work;
+            max_render = std::max(max_render, work);
+            ring.push();
         }
-        if (loops != 0)
+    });
+
+    // show images in the given order, the display thread only writes the rendered frames at their deadlines
+    FrameScheduler scheduler(delay);
+    std::chrono::steady_clock::duration total_work{}, max_work{};
+    long long stalls = 0, repaints = 0, bytes = 0;
+    long long last_shown = -1; // the frame on the screen, -1 after other output
+    for (long long frame = 0; frame < frames; ++frame)
+    {
+        if (frame % static_cast<long long>(order.size()) == 0)
+        {
+            std::cout << "looping!" << loops << std::endl;
+            std::cout << "order size: " << order.size() << std::endl;
+            last_shown = -1;
             --loops;
+        }
+
+        const FrameRing::Frame *ready = ring.front();
+        if (!ready)
+        {
+            stalls += frame > 0;
+            while (!(ready = ring.front()))
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+
+        // the deadlines count from the first frame, a frame too late for its period is skipped
+        if (frame == 0)
+            scheduler.start();
+        if (!scheduler.waitFor(frame))
+        {
+            ring.pop();
+            continue;
+        }
+
+        // the update only applies to the screen the frame before left
+        const std::string &output = last_shown == frame - 1 && !ready->repaint ? ready->update : ready->full;
+        repaints += &output == &ready->full;
+        bytes += output.size();
+        last_shown = frame;
+
+        auto start = std::chrono::steady_clock::now();
+        Terminal::write(output);
+        ring.pop();
+        auto work = std::chrono::steady_clock::now() - start;
+        total_work += work;
+        max_work = std::max(max_work, work);
+    }
+    scheduler.finish(frames);
+    producer.join();
+    // the frames do not end with a newline
+    if (scheduler.shownFrames() > 0)
+        std::cout << std::endl;
+
+    if (frames > 0)
+    {
+        using milliseconds = std::chrono::duration<double, std::milli>;
+        std::cout << std::fixed << std::setprecision(2) << "Shown " << scheduler.shownFrames() << " of " << frames
+                  << " frames at " << scheduler.achievedRate() << " fps";
+        if (delay > 0)
+            std::cout << " (target " << 1 / delay << ")";
+        std::cout << ", " << scheduler.droppedFrames() << " dropped, " << stalls << " waited for rendering" << std::endl;
+        std::cout << std::setprecision(3) << "Frame start lateness: median " << scheduler.lateness(50) * 1000
+                  << " ms, 95% " << scheduler.lateness(95) * 1000 << " ms, 99% " << scheduler.lateness(99) * 1000
+                  << " ms, max " << scheduler.lateness(100) * 1000 << " ms" << std::endl;
+        std::cout << "Display work per frame: average " << milliseconds(total_work).count() / std::max(1LL, scheduler.shownFrames())
+                  << " ms, max " << milliseconds(max_work).count() << " ms" << std::endl;
+        std::cout << "Rendering per frame: average " << milliseconds(total_render).count() / frames << " ms, max "
+                  << milliseconds(max_render).count() << " ms" << std::endl;
+        std::cout << "Written " << bytes / std::max(1LL, scheduler.shownFrames()) << " bytes per frame on average, "
+                  << repaints << " frames repainted the whole screen" << std::endl;
+        std::cout.unsetf(std::ios::fixed);
     }
 }
 
@@ -199,7 +489,7 @@ bool getOptions(std::vector<int> &numbers)
     while (std::cin >> number)
     {
         // if number is not a digit or is 0, clear the buffer and try again
-        if ((!isdigit(number) && number != '0') || number > '5')
+        if ((!isdigit(number) && number != '0') || number > '9')
         {
             std::cin.clear();
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
@@ -216,7 +506,7 @@ bool getOptions(std::vector<int> &numbers)
             end = true;
             break;
         }
-        if (std::find(numbers.begin(), numbers.end(), number) == numbers.end() && number >= 1 && number <= 4)
+        if (std::find(numbers.begin(), numbers.end(), number) == numbers.end() && ((number >= 1 && number <= 4) || (number >= 6 && number <= 9)))
             numbers.push_back(number);
 
         if (std::cin.peek() == '\n' || numbers.size() == 4 || std::cin.peek() == '0')
@@ -237,56 +527,172 @@ void listImages(std::vector<std::unique_ptr<Image>> &images)
     }
 }
 
-bool addImage(std::vector<std::unique_ptr<Image>> &images)
+std::vector<std::string> splitPaths(const std::string &line)
 {
-    // Prompt:
-    showPrompt();
-
-    // Get the path from user:
-    std::string path;
-    std::cin >> path;
+    std::vector<std::string> paths;
+    size_t i = 0;
+    while (true)
+    {
+        while (i < line.size() && isspace(static_cast<unsigned char>(line[i])))
+            ++i;
+        if (i == line.size())
+            break;
 
-    trimPath(path);
+        // paths dropped to the terminal are quoted, they can contain spaces
+        std::string token;
+        if (line[i] == '\'' || line[i] == '"')
+        {
+            size_t end = line.find(line[i], i + 1);
+            token = line.substr(i + 1, end == std::string::npos ? std::string::npos : end - i - 1);
+            i = end == std::string::npos ? line.size() : end + 1;
+        }
+        else
+        {
+            size_t end = i;
+            while (end < line.size() && !isspace(static_cast<unsigned char>(line[end])))
+                ++end;
+            token = line.substr(i, end - i);
+            i = end;
+        }
 
-    // Check if the path is correct:
-    if (path.find(".jpg") == std::string::npos && path.find(".bmp") == std::string::npos && path.find(".jpeg") == std::string::npos)
-    {
-        std::cout << "Not an image of specified format!" << std::endl;
-        return 0;
+        // expand patterns, in sorted order; a pattern without matches stays as it is and fails to load
+        glob_t matches;
+        if (token.find_first_of("*?[") != std::string::npos && glob(token.c_str(), 0, nullptr, &matches) == 0)
+        {
+            for (size_t m = 0; m < matches.gl_pathc; ++m)
+                paths.push_back(matches.gl_pathv[m]);
+            globfree(&matches);
+        }
+        else
+        {
+            paths.push_back(token);
+        }
     }
+    return paths;
+}
 
-    // Add an image to the vector of images if it is successfully loaded:
+std::unique_ptr<Image> createImage(const std::string &path)
+{
+    std::unique_ptr<Image> image;
     if (path.find(".jpg") != std::string::npos || path.find(".jpeg") != std::string::npos)
     {
-        images.push_back(std::make_unique<JpegImage>());
+        image = std::make_unique<JpegImage>();
     }
     else if (path.find(".bmp") != std::string::npos)
     {
-        images.push_back(std::make_unique<BmpImage>());
+        image = std::make_unique<BmpImage>();
     }
     else
+    {
+        return image;
+    }
+
+    std::string copy = path;
+    image->setPath(copy);
+    image->setStreaming(settings().streaming);
+    image->setLumaDecode(settings().lumaDecode);
+    image->setColorMode(settings().color);
+    image->setRenderMode(settings().render);
+    image->setDitherMode(settings().dither);
+    image->setHistoryLimit(settings().historyLimit);
+    if (settings().scaledDecode)
+    {
+        int columns, rows;
+        Terminal::getSize(columns, rows);
+        image->setTargetSize(columns, rows);
+    }
+    return image;
+}
+
+bool addImage(std::vector<std::unique_ptr<Image>> &images)
+{
+    // Prompt:
+    showPrompt();
+
+    // Get the paths from user, one or more paths or patterns on a line:
+    std::string line;
+    std::cin >> std::ws;
+    std::getline(std::cin, line);
+    std::vector<std::string> paths = splitPaths(line);
+
+    if (paths.size() > 1)
+    {
+        return importImages(images, paths) > 0;
+    }
+
+    // Check if the path is correct:
+    std::unique_ptr<Image> image = paths.empty() ? nullptr : createImage(paths[0]);
+    if (!image)
     {
         std::cout << "Not an image of specified format!" << std::endl;
         return 0;
     }
 
-    // Load the image:
-    images.back()->setPath(path);
-    if (!images.back()->loadImage(path))
+    // Add the image to the vector of images if it is successfully loaded:
+    if (!image->loadImage(paths[0]))
     {
-        images.pop_back();
         std::cout << "Try again!" << std::endl;
         return 0;
     }
 
-    images.back()->toGreyScale();
-    images.back()->convertGreyToAscii();
-    images.back()->resizeAsciiImage();
-    // images.back()->printAsciiArt();
+    image->toGreyScale();
+    image->resizeAsciiImage();
+    images.push_back(std::move(image));
 
     return 1;
 }
 
+size_t importImages(std::vector<std::unique_ptr<Image>> &images, const std::vector<std::string> &paths)
+{
+    std::vector<std::unique_ptr<Image>> loaded(paths.size());
+    std::vector<char> supported(paths.size());
+    std::vector<std::string> errors(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        loaded[i] = createImage(paths[i]);
+        supported[i] = loaded[i] != nullptr;
+    }
+
+    // Decode and render the images in parallel, the rows of one image are then handled by its own thread:
+    ThreadPool::shared().forEach(static_cast<int>(paths.size()), [&](int i)
+    {
+        if (!loaded[i])
+            return;
+        loaded[i]->setPrintErrors(false);
+        if (!loaded[i]->loadImage(paths[i]))
+        {
+            errors[i] = loaded[i]->getError();
+            loaded[i].reset();
+            return;
+        }
+        loaded[i]->toGreyScale();
+        loaded[i]->resizeAsciiImage();
+    });
+
+    // Add the images in the given order and report every failure:
+    size_t added = 0;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (loaded[i])
+        {
+            loaded[i]->setPrintErrors(true);
+            images.push_back(std::move(loaded[i]));
+            ++added;
+        }
+        else if (!supported[i])
+        {
+            std::cout << paths[i] << ": Not an image of specified format!" << std::endl;
+        }
+        else
+        {
+            std::cout << paths[i] << ": " << (errors[i].empty() ? "Could not be loaded" : errors[i]) << std::endl;
+        }
+    }
+    std::cout << "Added " << added << " of " << paths.size() << " images" << std::endl;
+
+    return added;
+}
+
 void addFilter(std::vector<std::unique_ptr<Image>> &images, int user_choice)
 {
     while (true)
@@ -301,6 +707,23 @@ void addFilter(std::vector<std::unique_ptr<Image>> &images, int user_choice)
         }
 
         listImages(images);
+
+        // Undo and redo go back and forth in the history instead of applying filters:
+        bool undo = std::find(numbers.begin(), numbers.end(), 6) != numbers.end();
+        bool redo = std::find(numbers.begin(), numbers.end(), 7) != numbers.end();
+        if (undo || redo)
+        {
+            if (undo ? !images[user_choice]->undoEdit() : !images[user_choice]->redoEdit())
+            {
+                std::cout << (undo ? "Nothing to undo" : "Nothing to redo") << std::endl;
+                continue;
+            }
+            images[user_choice]->resizeAsciiImage();
+            images[user_choice]->printAsciiArt();
+            showHistory(images[user_choice]);
+            continue;
+        }
+
         // First, convert to grey:
         images[user_choice]->toGreyScale();
 
@@ -315,27 +738,32 @@ void addFilter(std::vector<std::unique_ptr<Image>> &images, int user_choice)
         }
         if (std::find(numbers.begin(), numbers.end(), 3) != numbers.end())
         {
-            std::cout << "Enter the brightness change (from -255 to 255):" << std::endl;
-            std::cout << ">> ";
-            int brightness;
-
-            // Ask for brighness until user enter a valid integer
-            while (!(std::cin >> brightness) || brightness < -255 || brightness > 255)
-            {
-                std::cin.clear();
-                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                std::cout << "Try again" << std::endl;
-            }
-
-            images[user_choice]->changeBrigtness(brightness);
+            chooseContrast(images[user_choice]);
         }
         if (std::find(numbers.begin(), numbers.end(), 4) != numbers.end())
         {
             changeTransition(images[user_choice]);
         }
+        if (std::find(numbers.begin(), numbers.end(), 8) != numbers.end())
+        {
+            chooseConvolution(images[user_choice], false);
+        }
+        if (std::find(numbers.begin(), numbers.end(), 9) != numbers.end())
+        {
+            chooseConvolution(images[user_choice], true);
+        }
 
-        images[user_choice]->convertGreyToAscii();
         images[user_choice]->resizeAsciiImage();
         images[user_choice]->printAsciiArt();
+        showHistory(images[user_choice]);
     }
 }
+
+void showHistory(std::unique_ptr<Image> &im)
+{
+    const EditHistory &history = im->getHistory();
+    std::cout << "Edit " << history.position() + 1 << " of " << history.size() << ", history uses "
+              << std::fixed << std::setprecision(1) << history.memoryUsage() / 1048576.0 << " of "
+              << history.limit() / 1048576.0 << " MiB" << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+}
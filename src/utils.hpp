@@ -4,6 +4,40 @@
 #include "image.hpp"
 #include <string>
 #include <iomanip>
+#include <memory>
+#include <limits>
+
+/**
+ * @struct Settings
+ * @brief Program wide settings given on the command line.
+ */
+struct Settings
+{
+    bool streaming = false;    /**< Load images in streaming mode, see Image::setStreaming. */
+    bool scaledDecode = false; /**< Decode images at the terminal size, see Image::setTargetSize. */
+    bool lumaDecode = false;   /**< Decode JPEG images to luma directly, see Image::setLumaDecode. */
+    size_t historyLimit = EditHistory::DEFAULT_LIMIT; /**< The memory limit of the edit history of each image in bytes. */
+    unsigned threads = 0;      /**< The number of threads of the pixel stages, 0 for the number of hardware threads. */
+    AnsiColor::Mode color = AnsiColor::MODE_NONE; /**< The color sequences of the terminal, see Image::setColorMode. */
+    CellEncoding::Mode render = CellEncoding::MODE_ASCII; /**< The kind of cells, see Image::setRenderMode. */
+    Dither::Mode dither = Dither::MODE_NONE; /**< How the cells are dithered, see Image::setDitherMode. */
+};
+
+Settings &settings();
+/**
+ * @brief Get the program wide settings.
+ * @return The settings, with default values until parseArguments is called.
+ */
+
+bool parseArguments(int argc, char *argv[]);
+/**
+ * @brief Parse the command line arguments into the settings.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return True if all arguments are valid, false otherwise.
+ *
+ * Unknown arguments are reported together with the usage.
+ */
 
 bool welcomeUser();
 /**
@@ -15,15 +49,6 @@ bool welcomeUser();
  * The function returns true if the welcome message is displayed successfully, and false otherwise.
  */
 
-void trimPath(std::string &path);
-/**
- * @brief Trim the path string.
- * @param path The path string to be trimmed.
- *
- * This function trims the leading and trailing spaces from the path string.
- * It modifies the input string in-place.
- */
-
 void changeTransition(std::unique_ptr<Image> &im);
 /**
  * @brief Change the transition of an image.
@@ -33,6 +58,24 @@ void changeTransition(std::unique_ptr<Image> &im);
  * It takes a unique pointer to the Image object as a parameter and modifies the transition value.
  */
 
+void chooseConvolution(std::unique_ptr<Image> &im, bool edges);
+/**
+ * @brief Let the user choose a spatial filter of an image and its radius.
+ * @param im A unique pointer to the Image object.
+ * @param edges True to choose an edge detector, false to choose a blur or sharpening.
+ *
+ * The filter is recorded with Image::convolveImage.
+ */
+
+void chooseContrast(std::unique_ptr<Image> &im);
+/**
+ * @brief Let the user change the brightness or the contrast of an image.
+ * @param im A unique pointer to the Image object.
+ *
+ * The user picks a brightness change, auto levels, a local equalization or a gamma curve,
+ * the filter is recorded on the image.
+ */
+
 void showPrompt();
 /**
  * @brief Display the program prompt.
@@ -66,6 +109,10 @@ void animation(std::vector<std::unique_ptr<Image>> &images);
  *
  * This function performs an animation using the images in the specified vector.
  * It can be used to create a visual display or effect using the images.
+ * The frames are rendered ahead on a producer thread into a FrameRing, so the display thread
+ * only writes finished frames. A frame only updates the cells which changed, see TerminalScreen.
+ * A FrameScheduler shows the frames at absolute deadlines and skips frames when it falls behind.
+ * The frame rate, lateness, display work, rendering time and bytes written are reported at the end.
  */
 
 bool getOptions(std::vector<int> &numbers);
@@ -87,6 +134,23 @@ void listImages(std::vector<std::unique_ptr<Image>> &images);
  * It can be used to display the names or details of the images to the user.
  */
 
+std::vector<std::string> splitPaths(const std::string &line);
+/**
+ * @brief Split a line into paths.
+ * @param line The line with paths separated by spaces.
+ * @return The paths in the given order.
+ *
+ * Paths in single or double quotes can contain spaces. Patterns with *, ? or [ are expanded
+ * to the matching files in sorted order, a pattern without matches is kept as it is.
+ */
+
+std::unique_ptr<Image> createImage(const std::string &path);
+/**
+ * @brief Create an image object for a path, with the program settings applied.
+ * @param path The path to the image file.
+ * @return The image, not loaded yet, or nullptr if the extension is not supported.
+ */
+
 bool addImage(std::vector<std::unique_ptr<Image>> &images);
 /**
  * @brief Add an image to the collection.
@@ -96,6 +160,18 @@ bool addImage(std::vector<std::unique_ptr<Image>> &images);
  * This function allows the user to add an image to the collection.
  * It prompts the user for the image file path, loads the image, and adds it to the vector.
  * The function returns true if the image is added successfully, and false otherwise.
+ * With several paths or a pattern on the line the images are imported with importImages.
+ */
+
+size_t importImages(std::vector<std::unique_ptr<Image>> &images, const std::vector<std::string> &paths);
+/**
+ * @brief Load many images at once.
+ * @param images A vector of unique pointers to Image objects.
+ * @param paths The paths of the images.
+ * @return The number of images added.
+ *
+ * The images are decoded and rendered in parallel on the shared thread pool, then added to
+ * the vector in the order of the paths. Every file which fails is reported with its reason.
  */
 
 void addFilter(std::vector<std::unique_ptr<Image>> &images, int user_choice);
@@ -108,4 +184,10 @@ void addFilter(std::vector<std::unique_ptr<Image>> &images, int user_choice);
  * It takes the user's choice of filter as input and applies the corresponding filter to the image.
  */
 
+void showHistory(std::unique_ptr<Image> &im);
+/**
+ * @brief Display the position in the edit history of an image and its memory use.
+ * @param im A unique pointer to the Image object.
+ */
+
 #endif
@@ -0,0 +1,67 @@
+/**
+ * @file luminancetest.cpp
+ * @brief Check the luminance tables and row kernels against the pow() based formula.
+ *
+ * Every one of the 2^24 RGB triples is converted with greyOf and with every row kernel the CPU
+ * supports, the results must equal Luminance::referenceGrey bit for bit.
+ */
+
+#include "../src/luminance.hpp"
+#include <iostream>
+#include <vector>
+
+int main()
+{
+    // the reference of all triples, one row of 256 blue values per red and green pair
+    std::vector<unsigned char> reference(1 << 24);
+    std::vector<unsigned char> rgb(3 * 256);
+    for (int red = 0; red < 256; ++red)
+    {
+        for (int green = 0; green < 256; ++green)
+        {
+            for (int blue = 0; blue < 256; ++blue)
+                reference[(red << 16) | (green << 8) | blue] = Luminance::referenceGrey(red, green, blue);
+        }
+    }
+
+    int failures = 0;
+    long long mismatches = 0;
+    for (int red = 0; red < 256; ++red)
+    {
+        for (int green = 0; green < 256; ++green)
+        {
+            const unsigned char *expected = &reference[(red << 16) | (green << 8)];
+            for (int blue = 0; blue < 256; ++blue)
+                mismatches += Luminance::greyOf(red, green, blue) != expected[blue];
+        }
+    }
+    std::cout << "greyOf: " << mismatches << " mismatches" << std::endl;
+    failures += mismatches != 0;
+
+    std::vector<unsigned char> grey(256);
+    for (int kernel = 0; kernel < Luminance::kernelCount(); ++kernel)
+    {
+        mismatches = 0;
+        for (int red = 0; red < 256; ++red)
+        {
+            for (int green = 0; green < 256; ++green)
+            {
+                for (int blue = 0; blue < 256; ++blue)
+                {
+                    rgb[3 * blue] = static_cast<unsigned char>(red);
+                    rgb[3 * blue + 1] = static_cast<unsigned char>(green);
+                    rgb[3 * blue + 2] = static_cast<unsigned char>(blue);
+                }
+                Luminance::convertRowWith(kernel, rgb.data(), grey.data(), grey.size());
+                const unsigned char *expected = &reference[(red << 16) | (green << 8)];
+                for (int blue = 0; blue < 256; ++blue)
+                    mismatches += grey[blue] != expected[blue];
+            }
+        }
+        std::cout << "convertRow (" << Luminance::kernelName(kernel) << "): " << mismatches << " mismatches" << std::endl;
+        failures += mismatches != 0;
+    }
+    std::cout << "selected kernel: " << Luminance::kernelName() << std::endl;
+
+    return failures ? 1 : 0;
+}